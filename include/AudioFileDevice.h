@@ -47,6 +47,23 @@ public:
 
 	OutputSettings const & getOutputSettings() const { return m_outputSettings; }
 
+	// most frames writeRenderedBuffer() accepts at once
+	static const fpp_t MaxRenderedFrames = 8192;
+
+	// encode a buffer which didn't come from the mixer's nextBuffer(),
+	// e.g. the output of a single track or a batch of periods - it gets
+	// resampled to the sample rate of the file
+	void writeRenderedBuffer( const surroundSampleFrame * buffer,
+					fpp_t frames, float masterGain );
+
+	// encode a buffer which is at the sample rate of the file already,
+	// e.g. one read back from an intermediate file
+	void writeFileRateBuffer( const surroundSampleFrame * buffer,
+							fpp_t frames )
+	{
+		writeBuffer( buffer, frames, 1.0f );
+	}
+
 
 protected:
 	int writeData( const void* data, int len );
@@ -64,6 +81,7 @@ protected:
 private:
 	QFile m_outputFile;
 	OutputSettings m_outputSettings;
+	surroundSampleFrame * m_resampleBuffer;
 } ;
 
 
@@ -0,0 +1,82 @@
+/*
+ * AudioFileEncoder.h - encodes rendered periods on a separate thread
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUDIO_FILE_ENCODER_H
+#define AUDIO_FILE_ENCODER_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "lmms_basics.h"
+
+class AudioFileDevice;
+
+
+//! Collects the periods of an export into large blocks and hands them to
+//! the file device on a thread of its own, so that mixing and encoding
+//! run on separate cores
+class AudioFileEncoder : public QThread
+{
+public:
+	//! The device is not owned by the encoder
+	AudioFileEncoder( AudioFileDevice * device, fpp_t framesPerPeriod );
+	//! Calls finish() if that has not happened yet
+	virtual ~AudioFileEncoder();
+
+	//! Queue (part of) a period for encoding, applying master gain right
+	//! away - blocks while all blocks are waiting for the encoder
+	void write( const surroundSampleFrame * period, fpp_t frames,
+							float masterGain );
+
+	//! Encode the remaining frames and stop the thread
+	void finish();
+
+
+private:
+	virtual void run();
+
+	// number of blocks the mixer can be ahead of the encoder
+	static const int NUM_BLOCKS = 4;
+
+	AudioFileDevice * m_device;
+	const fpp_t m_framesPerPeriod;
+	const fpp_t m_framesPerBlock;
+
+	surroundSampleFrame * m_blocks[NUM_BLOCKS];
+	fpp_t m_blockFrames[NUM_BLOCKS];
+
+	// block being filled by write() and first block the encoder has not
+	// taken yet - both only ever grow
+	int m_head;
+	int m_tail;
+	fpp_t m_fill;
+	bool m_quit;
+
+	QMutex m_mutex;
+	QWaitCondition m_dataAvailable;
+	QWaitCondition m_spaceAvailable;
+
+} ;
+
+
+#endif
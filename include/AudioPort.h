@@ -25,7 +25,9 @@
 #ifndef AUDIO_PORT_H
 #define AUDIO_PORT_H
 
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <QtCore/QString>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
@@ -34,6 +36,7 @@
 #include "PlayHandle.h"
 
 class EffectChain;
+class FxChannel;
 class FloatModel;
 class BoolModel;
 
@@ -51,6 +54,12 @@ public:
 		return m_portBuffer;
 	}
 
+	// whether buffer() holds any output in the current period
+	inline bool hasOutput() const
+	{
+		return m_hasOutput;
+	}
+
 	inline void lockBuffer()
 	{
 		m_portBufferLock.lock();
@@ -105,10 +114,22 @@ public:
 	{
 		return true;
 	}
+	virtual const char * jobCategory() const
+	{
+		return "AudioPort";
+	}
+	virtual QString jobName() const
+	{
+		return m_name;
+	}
 
 	void addPlayHandle( PlayHandle * handle );
 	void removePlayHandle( PlayHandle * handle );
 
+	// called whenever one of our play handles has been rendered - queues
+	// this port once the last pending one is done (pipelined mode only)
+	void playHandleDone();
+
 private:
 	volatile bool m_bufferUsage;
 
@@ -118,17 +139,30 @@ private:
 	bool m_extOutputEnabled;
 	fx_ch_t m_nextFxChannel;
 
+	// channel we're feeding in the current period - set up by FxMixer
+	FxChannel * m_fxChannel;
+	// whether our buffer holds any output in the current period
+	bool m_hasOutput;
+
 	QString m_name;
 
 	std::unique_ptr<EffectChain> m_effects;
 
 	PlayHandleList m_playHandles;
 	QMutex m_playHandleLock;
+	// size of m_playHandles, so processing a port without play handles
+	// doesn't need to take the lock
+	std::atomic_int m_numPlayHandles;
+	std::atomic_int m_pendingPlayHandles;
+	// buffers of play handles to be mixed in current period
+	std::vector<const sampleFrame *> m_playHandleBuffers;
 
 	FloatModel * m_volumeModel;
 	FloatModel * m_panningModel;
 	BoolModel * m_mutedModel;
 
+	friend class FxChannel;
+	friend class FxMixer;
 	friend class Mixer;
 	friend class MixerWorkerThread;
 
@@ -25,6 +25,8 @@
 #ifndef AUTOMATABLE_MODEL_H
 #define AUTOMATABLE_MODEL_H
 
+#include <atomic>
+
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 
@@ -61,6 +63,7 @@
 
 
 
+class AutomationPattern;
 class ControllerConnection;
 
 class LMMS_EXPORT AutomatableModel : public Model, public JournallingObject
@@ -70,6 +73,14 @@ class LMMS_EXPORT AutomatableModel : public Model, public JournallingObject
 public:
 	typedef QVector<AutomatableModel *> AutoModelVector;
 
+	//! How many models had to compute their valueBuffer() in a period -
+	//! all further calls within the period return the cached buffer
+	struct Statistics
+	{
+		int resolved;		//!< models which computed their buffer
+		int sampleExact;	//!< of these, models with sample-exact data
+	} ;
+
 	enum ScaleType
 	{
 		Linear,
@@ -163,6 +174,10 @@ public:
 	void setInitValue( const float value );
 
 	void setAutomatedValue( const float value );
+	//! Sets frames starting at offset of this period's valueBuffer() to
+	//! given automation values - frames before offset keep the old value
+	//! unless they were set already
+	void setAutomatedValues( const float * values, int offset, int frames );
 	void setValue( const float value );
 
 	void incValue( int steps )
@@ -251,10 +266,10 @@ public:
 		m_hasStrictStepSize = b;
 	}
 
-	static void incrementPeriodCounter()
-	{
-		++s_periodCounter;
-	}
+	static void incrementPeriodCounter();
+
+	//! Statistics of the last completed period
+	static Statistics lastPeriodStatistics();
 
 	static void resetPeriodCounter()
 	{
@@ -304,6 +319,10 @@ private:
 	//! @param value will be modified to rounded value
 	template<class T> void roundAt( T &value, const T &where ) const;
 
+	//! computes this period's m_valueBuffer, returns whether there is
+	//! sample-exact data
+	bool updateValueBuffer();
+
 
 	ScaleType m_scaleType; //! scale type, linear by default
 	float m_value;
@@ -332,7 +351,9 @@ private:
 
 
 	ValueBuffer m_valueBuffer;
-	long m_lastUpdatedPeriod;
+	// period m_valueBuffer and m_hasSampleExactData have been published
+	// for - once it matches s_periodCounter they are only read
+	std::atomic<long> m_lastUpdatedPeriod;
 	static long s_periodCounter;
 
 	bool m_hasSampleExactData;
@@ -340,6 +361,11 @@ private:
 	// prevent several threads from attempting to write the same vb at the same time
 	QMutex m_valueBufferMutex;
 
+	static std::atomic<int> s_resolvedModels;
+	static std::atomic<int> s_sampleExactModels;
+	static std::atomic<int> s_lastResolvedModels;
+	static std::atomic<int> s_lastSampleExactModels;
+
 signals:
 	void initValueChanged( float val );
 	void destroyed( jo_id_t id );
@@ -424,6 +450,8 @@ public:
 } ;
 
 typedef QMap<AutomatableModel*, float> AutomatedValueMap;
+//! pattern each automated model follows, used to render sample-exact values
+typedef QMap<AutomatableModel*, const AutomationPattern*> AutomationPatternMap;
 
 #endif
 
@@ -0,0 +1,85 @@
+/*
+ * AutomationCursor.h - incremental evaluation of song automation
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUTOMATION_CURSOR_H
+#define AUTOMATION_CURSOR_H
+
+#include <vector>
+
+#include "TrackContainer.h"
+
+
+/*! \brief Follows the playback position through the automation of a song
+ *
+ * TrackContainer::automatedValuesFromTracks() looks at every automation and
+ * BB TCO from the beginning of the song on each call. The cursor instead
+ * remembers the TCOs which have started so far and forgets about those whose
+ * values are completely overridden by later ones. When time moves on, only
+ * TCOs which started in between are looked up.
+ *
+ * Everything is collected again after the tracks or their TCOs changed or
+ * when time moves backwards. Not thread-safe, meant to be used by the thread
+ * playing the song only.
+ */
+class AutomationCursor
+{
+public:
+	AutomationCursor();
+
+	//! Forget everything, the next call of valuesAt() starts from scratch
+	void reset();
+
+	//! Same as TrackContainer::automatedValuesFromTracks( tracks, time ),
+	//! see TrackContainer::automatedValuesFromTCOs() for patterns
+	AutomatedValueMap valuesAt( const TrackContainer::TrackList & tracks, MidiTime time,
+					AutomationPatternMap * patterns = NULL );
+
+private:
+	struct TrackState
+	{
+		Track * track;
+		bool muted;
+		unsigned int revision;
+	} ;
+
+	// whatever pruning a TCO relied on while collecting
+	struct TCOState
+	{
+		bool muted;
+		bool hasAutomation;
+	} ;
+
+	bool isUpToDate( const TrackContainer::TrackList & tracks, MidiTime time ) const;
+	void collect( const TrackContainer::TrackList & tracks, MidiTime from, MidiTime to );
+	void prune();
+
+	bool m_valid;
+	MidiTime m_time;
+	std::vector<TrackState> m_trackStates;
+	// TCOs which started so far and may still determine a value, by position
+	Track::tcoVector m_tcos;
+	std::vector<TCOState> m_tcoStates;
+
+} ;
+
+
+#endif
@@ -27,9 +27,11 @@
 #ifndef AUTOMATION_PATTERN_H
 #define AUTOMATION_PATTERN_H
 
-#include <QtCore/QMap>
+#include <atomic>
+
 #include <QtCore/QPointer>
 
+#include "AutomationTimeMap.h"
 #include "Track.h"
 
 
@@ -49,7 +51,7 @@ public:
 		CubicHermiteProgression
 	} ;
 
-	typedef QMap<int, float> timeMap;
+	typedef AutomationTimeMap timeMap;
 	typedef QVector<QPointer<AutomatableModel> > objectVector;
 
 	AutomationPattern( AutomationTrack * _auto_track );
@@ -109,16 +111,6 @@ public:
 		return m_timeMap;
 	}
 
-	inline const timeMap & getTangents() const
-	{
-		return m_tangents;
-	}
-
-	inline timeMap & getTangents()
-	{
-		return m_tangents;
-	}
-
 	inline float getMin() const
 	{
 		return firstObject()->minValue<float>();
@@ -136,6 +128,10 @@ public:
 
 	float valueAt( const MidiTime & _time ) const;
 	float *valuesAfter( const MidiTime & _time ) const;
+	//! Renders values at tick, tick + ticksPerFrame, ... into given buffer.
+	//! Positions after lastTick are evaluated at lastTick.
+	void valuesAt( float tick, float ticksPerFrame, float lastTick,
+					float * values, int frames ) const;
 
 	const QString name() const;
 
@@ -170,20 +166,24 @@ public slots:
 private:
 	void cleanObjects();
 	void generateTangents();
-	void generateTangents( timeMap::const_iterator it, int numToGenerate );
+	void generateTangents( timeMap::iterator it, int numToGenerate );
 	float valueAt( timeMap::const_iterator v, int offset ) const;
 
 	AutomationTrack * m_autoTrack;
 	QVector<jo_id_t> m_idsToResolve;
 	objectVector m_objects;
-	timeMap m_timeMap;	// actual values
+	timeMap m_timeMap;	// actual values and tangents
 	timeMap m_oldTimeMap;	// old values for storing the values before setDragValue() is called.
-	timeMap m_tangents;	// slope at each point for calculating spline
 	float m_tension;
 	bool m_hasAutomation;
 	ProgressionTypes m_progressionType;
 
 	bool m_dragging;
+
+	// point looked up last by valueAt() - playback mostly stays within
+	// the same segment. Only a hint which is checked before use, but both
+	// the GUI and the mixer call valueAt()
+	mutable std::atomic<int> m_lookupHint;
 	
 	bool m_isRecording;
 	float m_lastRecordedValue;
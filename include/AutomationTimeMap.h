@@ -0,0 +1,285 @@
+/*
+ * AutomationTimeMap.h - flat sorted storage of automation points
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUTOMATION_TIME_MAP_H
+#define AUTOMATION_TIME_MAP_H
+
+#include <vector>
+
+#include <QtCore/QList>
+
+#include "lmms_export.h"
+
+
+/*! \brief Map from tick to value (and tangent) of automation points
+ *
+ * Provides the parts of the QMap interface the automation code uses, but
+ * keeps ticks, values and tangents in three sorted arrays so that lookups
+ * are binary searches over contiguous memory and walking along the points
+ * doesn't chase any pointers. Appending points (e.g. while recording) is
+ * amortised constant, inserting elsewhere just moves the points behind.
+ *
+ * Iterators are positions in the arrays - like with QMap they stay valid
+ * when values change, but unlike QMap only points behind an iterator may
+ * be added or removed while it is in use.
+ */
+class LMMS_EXPORT AutomationTimeMap
+{
+	template<class Map, class Value>
+	class IteratorBase
+	{
+	public:
+		IteratorBase() :
+			m_map( nullptr ),
+			m_index( 0 )
+		{
+		}
+
+		IteratorBase( Map * map, int index ) :
+			m_map( map ),
+			m_index( index )
+		{
+		}
+
+		// iterator -> const_iterator
+		template<class OtherMap, class OtherValue>
+		IteratorBase( const IteratorBase<OtherMap, OtherValue> & other ) :
+			m_map( other.m_map ),
+			m_index( other.m_index )
+		{
+		}
+
+		int key() const
+		{
+			return m_map->m_ticks[m_index];
+		}
+
+		Value & value() const
+		{
+			return m_map->m_values[m_index];
+		}
+
+		Value & operator*() const
+		{
+			return value();
+		}
+
+		Value & tangent() const
+		{
+			return m_map->m_tangents[m_index];
+		}
+
+		int index() const
+		{
+			return m_index;
+		}
+
+		IteratorBase & operator++()
+		{
+			++m_index;
+			return *this;
+		}
+
+		IteratorBase operator++( int )
+		{
+			IteratorBase it = *this;
+			++m_index;
+			return it;
+		}
+
+		IteratorBase & operator--()
+		{
+			--m_index;
+			return *this;
+		}
+
+		IteratorBase operator--( int )
+		{
+			IteratorBase it = *this;
+			--m_index;
+			return it;
+		}
+
+		IteratorBase operator+( int n ) const
+		{
+			return IteratorBase( m_map, m_index + n );
+		}
+
+		IteratorBase operator-( int n ) const
+		{
+			return IteratorBase( m_map, m_index - n );
+		}
+
+		template<class OtherMap, class OtherValue>
+		bool operator==( const IteratorBase<OtherMap, OtherValue> & other ) const
+		{
+			return m_index == other.m_index && m_map == other.m_map;
+		}
+
+		template<class OtherMap, class OtherValue>
+		bool operator!=( const IteratorBase<OtherMap, OtherValue> & other ) const
+		{
+			return !( *this == other );
+		}
+
+	private:
+		Map * m_map;
+		int m_index;
+
+		template<class, class> friend class IteratorBase;
+
+	} ;
+
+public:
+	typedef IteratorBase<AutomationTimeMap, float> iterator;
+	typedef IteratorBase<const AutomationTimeMap, const float> const_iterator;
+	typedef iterator Iterator;
+	typedef const_iterator ConstIterator;
+
+	bool isEmpty() const
+	{
+		return m_ticks.empty();
+	}
+
+	bool empty() const
+	{
+		return isEmpty();
+	}
+
+	int size() const
+	{
+		return static_cast<int>( m_ticks.size() );
+	}
+
+	void clear();
+
+	iterator begin()
+	{
+		return iterator( this, 0 );
+	}
+
+	iterator end()
+	{
+		return iterator( this, size() );
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator( this, 0 );
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator( this, size() );
+	}
+
+	const_iterator constBegin() const
+	{
+		return begin();
+	}
+
+	const_iterator constEnd() const
+	{
+		return end();
+	}
+
+	//! first point at or after tick
+	iterator lowerBound( int tick )
+	{
+		return iterator( this, lowerBoundIndex( tick ) );
+	}
+
+	const_iterator lowerBound( int tick ) const
+	{
+		return const_iterator( this, lowerBoundIndex( tick ) );
+	}
+
+	//! first point after tick
+	iterator upperBound( int tick )
+	{
+		return iterator( this, upperBoundIndex( tick ) );
+	}
+
+	const_iterator upperBound( int tick ) const
+	{
+		return const_iterator( this, upperBoundIndex( tick ) );
+	}
+
+	iterator find( int tick )
+	{
+		return iterator( this, findIndex( tick ) );
+	}
+
+	const_iterator find( int tick ) const
+	{
+		return const_iterator( this, findIndex( tick ) );
+	}
+
+	bool contains( int tick ) const
+	{
+		return findIndex( tick ) != size();
+	}
+
+	//! value of the point at tick, inserts a point with value 0 if needed
+	float & operator[]( int tick );
+
+	float operator[]( int tick ) const
+	{
+		return value( tick );
+	}
+
+	float value( int tick, float defaultValue = 0 ) const;
+
+	iterator insert( int tick, float value );
+
+	//! returns the number of removed points (0 or 1)
+	int remove( int tick );
+
+	iterator erase( iterator it );
+
+	QList<int> keys() const;
+	QList<float> values() const;
+
+	/*! Index of the last point at or before tick, -1 if there is none.
+	 *  Sequential lookups should pass the previous result as hint - the
+	 *  hinted point and the next ones are checked before searching. */
+	int lastIndexAt( float tick, int hint = -1 ) const;
+
+	const int * ticks() const
+	{
+		return m_ticks.data();
+	}
+
+private:
+	int lowerBoundIndex( int tick ) const;
+	int upperBoundIndex( int tick ) const;
+	int findIndex( int tick ) const;
+
+	std::vector<int> m_ticks;
+	std::vector<float> m_values;
+	// slope at each point for calculating splines
+	std::vector<float> m_tangents;
+
+} ;
+
+
+#endif
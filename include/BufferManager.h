@@ -29,9 +29,26 @@
 #include "lmms_export.h"
 #include "lmms_basics.h"
 
+/*! \brief Pool of period-sized sample buffers
+ *
+ * Buffers are preallocated in init() and recycled through a lock-free free
+ * list with small per-thread caches in front of it. The pool only grows if
+ * more buffers are in use at once than ever before, so in steady state
+ * acquire() and release() never call into the allocator. */
 class LMMS_EXPORT BufferManager
 {
 public:
+	struct Statistics
+	{
+		int buffers;		//!< buffers currently owned by the pool
+		int inUse;		//!< buffers currently acquired
+		int highWaterMark;	//!< maximum of inUse since last init()
+		int allocations;	//!< buffers allocated because the pool ran dry
+	} ;
+
+	//! (Re-)initializes the pool for given period size. Must not run while
+	//! other threads acquire buffers. Buffers of the old size which are
+	//! still in use get freed when being released.
 	static void init( fpp_t framesPerPeriod );
 	static sampleFrame * acquire();
 	// audio-buffer-mgm
@@ -42,6 +59,12 @@ public:
 						const f_cnt_t offset = 0 );
 #endif
 	static void release( sampleFrame * buf );
+
+	//! Hands the buffers cached by the calling thread back to the pool.
+	//! Called by MemoryManager::ThreadGuard when a thread finishes.
+	static void releaseThreadCache();
+
+	static Statistics statistics();
 };
 
 #endif
@@ -51,7 +51,12 @@ protected slots:
 
 
 private:
+	void updateToolTip();
+
 	int m_currentLoad;
+	int m_xruns;
+	// number of updates the indicator stays lit after a missed deadline
+	int m_xrunIndicator;
 
 	QPixmap m_temp;
 	QPixmap m_background;
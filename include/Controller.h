@@ -27,13 +27,17 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include <vector>
+
 #include "lmms_export.h"
 #include "Engine.h"
 #include "Model.h"
 #include "JournallingObject.h"
 #include "templates.h"
+#include "ThreadableJob.h"
 #include "ValueBuffer.h"
 
+class AutomatableModel;
 class ControllerDialog;
 class Controller;
 class ControllerConnection;
@@ -41,7 +45,7 @@ class ControllerConnection;
 typedef QVector<Controller *> ControllerVector;
 
 
-class LMMS_EXPORT Controller : public Model, public JournallingObject
+class LMMS_EXPORT Controller : public Model, public JournallingObject, public ThreadableJob
 {
 	Q_OBJECT
 public:
@@ -132,6 +136,15 @@ public:
 
 	bool hasModel( const Model * m ) const;
 
+	// queues all controllers which are connected to any model for updating
+	// their value buffers - controllers reading other controllers get
+	// queued once these are done, so the job queue has to be dynamic
+	static void queueControllers();
+
+	virtual bool requiresProcessing() const { return true; }
+	virtual const char * jobCategory() const { return "Controller"; }
+	virtual QString jobName() const { return name(); }
+
 public slots:
 	virtual ControllerDialog * createDialog( QWidget * _parent );
 
@@ -147,6 +160,15 @@ protected:
 
 	virtual void updateValueBuffer();
 
+	// calls dependsOn() for all models read by updateValueBuffer()
+	virtual void addDependencies()
+	{
+	}
+
+	// updateValueBuffer() reads given model, so a controller connected to
+	// it has to be updated first
+	void dependsOn( const AutomatableModel * model );
+
 	// buffer for storing sample-exact values in case there
 	// are more than one model wanting it, so we don't have to create it
 	// again every time
@@ -165,6 +187,21 @@ protected:
 
 	static long s_periods;
 
+private:
+	virtual void doProcessing();
+	void dependencyDone();
+
+	// controllers which have to wait for this one
+	std::vector<Controller *> m_dependents;
+	// number of controllers we have to wait for
+	int m_dependencies;
+	std::atomic_int m_dependenciesMet;
+	// last call of queueControllers() which collected this controller
+	long m_queuedRound;
+
+	static std::vector<Controller *> s_queuedControllers;
+	static long s_queueRounds;
+
 
 signals:
 	// The value changed while the mixer isn't running (i.e: MIDI CC)
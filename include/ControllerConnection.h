@@ -85,6 +85,11 @@ public:
 
 	static void finalizeConnections();
 
+	static const ControllerConnectionVector & connections()
+	{
+		return s_connections;
+	}
+
 	virtual void saveSettings( QDomDocument & _doc, QDomElement & _this );
 	virtual void loadSettings( const QDomElement & _this );
 
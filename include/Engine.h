@@ -57,7 +57,9 @@ class LMMS_EXPORT LmmsCore : public QObject
 {
 	Q_OBJECT
 public:
-	static void init( bool renderOnly );
+	//! threads is the number of threads the mixer renders with, 0 for one
+	//! per core
+	static void init( bool renderOnly, int threads = 0 );
 	static void destroy();
 
 	// core
@@ -32,6 +32,7 @@
 
 #include <atomic>
 
+class AudioPort;
 class FxRoute;
 typedef QVector<FxRoute *> FxRouteVector;
 
@@ -43,7 +44,7 @@ class FxChannel : public ThreadableJob
 
 		EffectChain m_fxChain;
 
-		// set to true when input fed from mixToChannel or child channel
+		// set to true when input fed from audio port or child channel
 		bool m_hasInput;
 		// set to true if any effect in the channel is enabled and running
 		bool m_stillRunning;
@@ -56,7 +57,6 @@ class FxChannel : public ThreadableJob
 		BoolModel m_soloModel;
 		FloatModel m_volumeModel;
 		QString m_name;
-		QMutex m_lock;
 		int m_channelIndex; // what channel index are we
 		bool m_queued; // are we queued up for rendering yet?
 		bool m_muted; // are we muted? updated per period so we don't have to call m_muteModel.value() twice
@@ -67,10 +67,17 @@ class FxChannel : public ThreadableJob
 		// pointers to other channels that send to this one
 		FxRouteVector m_receives;
 
+		// audio ports sending to this channel in the current period
+		QVector<AudioPort *> m_inputPorts;
+
 		virtual bool requiresProcessing() const { return true; }
+		virtual const char * jobCategory() const { return "FxChannel"; }
+		virtual QString jobName() const { return m_name; }
 		void unmuteForSolo();
 
 	
+		// number of input ports and senders we have to wait for
+		int m_dependencies;
 		std::atomic_int m_dependenciesMet;
 		void incrementDeps();
 		void processed();
@@ -128,9 +135,13 @@ public:
 	FxMixer();
 	virtual ~FxMixer();
 
-	void mixToChannel( const sampleFrame * _buf, fx_ch_t _ch );
-
 	void prepareMasterMix();
+
+	// connect given audio ports to the channels they send to and queue
+	// all channels not depending on anything - the remaining channels get
+	// queued by the audio ports and channels feeding them
+	void queueChannels( const QVector<AudioPort *> & _ports );
+
 	void masterMix( sampleFrame * _buf );
 
 	virtual void saveSettings( QDomDocument & _doc, QDomElement & _parent );
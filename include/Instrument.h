@@ -68,6 +68,15 @@ public:
 	// output buffer only once per mixer-period
 	virtual void play( sampleFrame * _working_buffer );
 
+	// called by the mixer for instruments with an instrument-play-handle
+	// before any play handle is rendered, if no note play handle sends MIDI
+	// events in this period - instruments running in another process can
+	// re-implement it to start on the period already and collect the
+	// result in play()
+	virtual void startRendering()
+	{
+	}
+
 	// to be implemented by actual plugin
 	virtual void playNote( NotePlayHandle * /* _note_to_play */,
 					sampleFrame * /* _working_buf */ )
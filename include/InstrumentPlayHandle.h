@@ -40,6 +40,10 @@ public:
 	}
 
 
+	// lets the instrument start on the period before the play handles
+	// are rendered, unless note play handles will send MIDI events then
+	void startRendering();
+
 	virtual void play( sampleFrame * _working_buffer )
 	{
 		// if the instrument is midi-based, we can safely render right away
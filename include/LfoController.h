@@ -61,6 +61,7 @@ public slots:
 protected:
 	// The internal per-controller value updating function
 	virtual void updateValueBuffer();
+	virtual void addDependencies();
 
 	FloatModel m_baseModel;
 	TempoSyncKnobModel m_speedModel;
@@ -27,26 +27,45 @@
 
 #include <atomic>
 #include <stddef.h>
+#include <stdint.h>
 
+// Fixed-size pool with a lock-free free list (Treiber stack). The list head
+// carries a tag which is incremented on every change to protect against ABA.
 class LocklessAllocator
 {
 public:
+	struct Statistics
+	{
+		size_t capacity;
+		size_t available;
+		// failed compare-and-swap attempts in alloc() and free()
+		size_t casRetries;
+		// alloc() calls which found the pool empty
+		size_t exhaustions;
+	} ;
+
 	LocklessAllocator( size_t nmemb, size_t size );
 	virtual ~LocklessAllocator();
 	void * alloc();
 	void free( void * ptr );
 
+	Statistics statistics() const;
+
 
 private:
 	char * m_pool;
 	size_t m_capacity;
 	size_t m_elementSize;
 
-	std::atomic_int * m_freeState;
-	size_t m_freeStateSets;
+	// next free element for each element in the free list
+	std::atomic<uint32_t> * m_next;
+	// index of first free element in lower, tag in upper 32 bits
+	std::atomic<uint64_t> m_freeList;
 
 	std::atomic_int m_available;
-	std::atomic_int m_startIndex;
+
+	std::atomic<size_t> m_casRetries;
+	std::atomic<size_t> m_exhaustions;
 
 } ;
 
@@ -76,6 +95,9 @@ public:
 		LocklessAllocator::free( ptr );
 	}
 
+	using LocklessAllocator::Statistics;
+	using LocklessAllocator::statistics;
+
 } ;
 
 
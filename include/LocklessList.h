@@ -50,9 +50,14 @@ public:
 		delete m_allocator;
 	}
 
-	void push( T value )
+	// returns false if there's no space left
+	bool push( T value )
 	{
 		Element * e = m_allocator->alloc();
+		if( e == nullptr )
+		{
+			return false;
+		}
 		e->value = value;
 		e->next = m_first.load(std::memory_order_relaxed);
 
@@ -62,6 +67,7 @@ public:
 		{
 			// Empty loop (compare_exchange_weak updates e->next)
 		}
+		return true;
 	}
 
 	Element * popList()
@@ -84,6 +90,11 @@ public:
 		m_allocator->free( e );
 	}
 
+	LocklessAllocator::Statistics allocatorStatistics() const
+	{
+		return m_allocator->statistics();
+	}
+
 
 private:
 	std::atomic<Element*> m_first;
@@ -69,6 +69,13 @@ void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float c
 /*! \brief Multiply dst by coeffDst and add samples from srcLeft/srcRight multiplied by coeffSrc */
 void multiplyAndAddMultipliedJoined( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames );
 
+/*! \brief Write sum of srcCount buffers from srcs with volume and panning applied to dst
+ *
+ * Volume and panning are given in percent like in the according models. They
+ * are read per frame if their stride is 1 or used as constant if it is 0. */
+void sumWithVolumeAndPanning( sampleFrame* dst, const sampleFrame* const* srcs, int srcCount,
+				const float* volume, int volumeStride, const float* panning, int panningStride, int frames );
+
 }
 
 #endif
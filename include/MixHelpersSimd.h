@@ -0,0 +1,79 @@
+/*
+ * MixHelpersSimd.h - runtime-selected kernel tables for MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef MIX_HELPERS_SIMD_H
+#define MIX_HELPERS_SIMD_H
+
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+namespace MixHelpers
+{
+
+/*! \brief Table of implementations behind the public MixHelpers functions
+ *
+ * Every instruction set gets its own table, built in its own translation unit
+ * with the matching compiler flags. One of them is picked once at startup
+ * depending on what the CPU supports. Coefficient buffers are passed as plain
+ * arrays with one value per frame. */
+struct Kernels
+{
+	const char * name;
+
+	bool (*isSilent)( const sampleFrame* src, int frames );
+	bool (*sanitize)( sampleFrame* src, int frames );
+	void (*add)( sampleFrame* dst, const sampleFrame* src, int frames );
+	void (*addMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames );
+	void (*addMultipliedByBuffer)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames );
+	void (*addMultipliedByBuffers)( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames );
+	void (*addSanitizedMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames );
+	void (*addSanitizedMultipliedByBuffer)( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames );
+	void (*addSanitizedMultipliedByBuffers)( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames );
+	void (*addMultipliedStereo)( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames );
+	void (*multiplyAndAddMultiplied)( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames );
+	void (*sumWithVolumeAndPanning)( sampleFrame* dst, const sampleFrame* const* srcs, int srcCount,
+				const float* volume, int volumeStride, const float* panning, int panningStride, int frames );
+} ;
+
+//! Plain C++ implementation, always available and used as reference
+LMMS_EXPORT const Kernels & scalarKernels();
+
+//! All tables which are compiled in and supported by the running CPU,
+//! from the least to the most preferred one (i.e. scalar comes first)
+LMMS_EXPORT std::vector<const Kernels *> supportedKernels();
+
+//! The table all public MixHelpers functions dispatch to
+LMMS_EXPORT const Kernels & activeKernels();
+
+// per instruction set tables - nullptr if not compiled in. These are plain
+// constant initialized data so they can be looked at without executing any
+// code compiled for an instruction set the CPU might lack.
+extern const Kernels * const sse2Kernels;
+extern const Kernels * const avx2Kernels;
+extern const Kernels * const avx512Kernels;
+extern const Kernels * const neonKernels;
+
+}
+
+#endif
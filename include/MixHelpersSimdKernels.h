@@ -0,0 +1,401 @@
+/*
+ * MixHelpersSimdKernels.h - generic vector implementation of MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef MIX_HELPERS_SIMD_KERNELS_H
+#define MIX_HELPERS_SIMD_KERNELS_H
+
+// Only to be included by the per instruction set translation units
+// (MixHelpersSse2.cpp etc.). Everything lives in an anonymous namespace so
+// that code compiled with different instruction sets never gets merged by
+// the linker.
+
+#include <cmath>
+
+#include "MixHelpersSimd.h"
+
+namespace MixHelpers
+{
+namespace
+{
+
+/* A vector traits class T has to provide:
+ *
+ *   typedef V            - vector of Width floats
+ *   typedef M            - lane mask as returned by finite()
+ *   load/store           - unaligned memory access
+ *   set1( x )            - broadcast x
+ *   stereo( l, r )       - { l, r, l, r, ... }
+ *   perFrame( p )        - { p[0], p[0], p[1], p[1], ... }
+ *   add/mul/min/max/abs
+ *   finite( v )          - mask of lanes which are neither inf nor nan
+ *   keep( m, v )         - v with all lanes not in m set to +0.0
+ *   all( m )             - true if all lanes are set in m
+ *   anyGreaterEqual( a, b )
+ *
+ * All operations are evaluated in the same order as in the scalar code and
+ * never fused so results are identical to the scalar implementation. */
+
+const float SilenceThreshold = 0.0000001f;
+
+inline bool isFiniteSample( float x )
+{
+	return x - x == 0.0f;
+}
+
+inline float * samples( sampleFrame * buf )
+{
+	return reinterpret_cast<float *>( buf );
+}
+
+inline const float * samples( const sampleFrame * buf )
+{
+	return reinterpret_cast<const float *>( buf );
+}
+
+
+
+template<class T>
+bool isSilent( const sampleFrame* src, int frames )
+{
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V threshold = T::set1( SilenceThreshold );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		if( T::anyGreaterEqual( T::abs( T::load( s + i ) ), threshold ) )
+		{
+			return false;
+		}
+	}
+	for( ; i < n; ++i )
+	{
+		if( fabsf( s[i] ) >= SilenceThreshold )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+template<class T>
+bool sanitize( sampleFrame* src, int frames )
+{
+	float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V lower = T::set1( -4.0f );
+	const typename T::V upper = T::set1( 4.0f );
+
+	bool found = false;
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::load( s + i );
+		const typename T::M ok = T::finite( x );
+		found |= !T::all( ok );
+		T::store( s + i, T::keep( ok, T::max( T::min( x, upper ), lower ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		if( !isFiniteSample( s[i] ) )
+		{
+			s[i] = 0.0f;
+			found = true;
+		}
+		else
+		{
+			s[i] = s[i] < -4.0f ? -4.0f : ( s[i] > 4.0f ? 4.0f : s[i] );
+		}
+	}
+	return found;
+}
+
+
+
+template<class T>
+void add( sampleFrame* dst, const sampleFrame* src, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		T::store( d + i, T::add( T::load( d + i ), T::load( s + i ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += s[i];
+	}
+}
+
+
+
+template<class T>
+void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V c = T::set1( coeffSrc );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		T::store( d + i, T::add( T::load( d + i ), T::mul( T::load( s + i ), c ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += s[i] * coeffSrc;
+	}
+}
+
+
+
+template<class T>
+void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V c = T::set1( coeffSrc );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::mul( T::mul( T::load( s + i ), c ), T::perFrame( coeffSrcBuf + i / 2 ) );
+		T::store( d + i, T::add( T::load( d + i ), x ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += s[i] * coeffSrc * coeffSrcBuf[i / 2];
+	}
+}
+
+
+
+template<class T>
+void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::mul( T::mul( T::load( s + i ), T::perFrame( coeffSrcBuf1 + i / 2 ) ),
+							T::perFrame( coeffSrcBuf2 + i / 2 ) );
+		T::store( d + i, T::add( T::load( d + i ), x ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += s[i] * coeffSrcBuf1[i / 2] * coeffSrcBuf2[i / 2];
+	}
+}
+
+
+
+template<class T>
+void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V c = T::set1( coeffSrc );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::load( s + i );
+		T::store( d + i, T::add( T::load( d + i ), T::keep( T::finite( x ), T::mul( x, c ) ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += isFiniteSample( s[i] ) ? s[i] * coeffSrc : 0.0f;
+	}
+}
+
+
+
+template<class T>
+void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V c = T::set1( coeffSrc );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::load( s + i );
+		const typename T::V y = T::mul( T::mul( x, c ), T::perFrame( coeffSrcBuf + i / 2 ) );
+		T::store( d + i, T::add( T::load( d + i ), T::keep( T::finite( x ), y ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += isFiniteSample( s[i] ) ? s[i] * coeffSrc * coeffSrcBuf[i / 2] : 0.0f;
+	}
+}
+
+
+
+template<class T>
+void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		const typename T::V x = T::load( s + i );
+		const typename T::V y = T::mul( T::mul( x, T::perFrame( coeffSrcBuf1 + i / 2 ) ),
+							T::perFrame( coeffSrcBuf2 + i / 2 ) );
+		T::store( d + i, T::add( T::load( d + i ), T::keep( T::finite( x ), y ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += isFiniteSample( s[i] ) ? s[i] * coeffSrcBuf1[i / 2] * coeffSrcBuf2[i / 2] : 0.0f;
+	}
+}
+
+
+
+template<class T>
+void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V c = T::stereo( coeffSrcLeft, coeffSrcRight );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		T::store( d + i, T::add( T::load( d + i ), T::mul( T::load( s + i ), c ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] += s[i] * ( i % 2 ? coeffSrcRight : coeffSrcLeft );
+	}
+}
+
+
+
+template<class T>
+void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+{
+	float * d = samples( dst );
+	const float * s = samples( src );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V cd = T::set1( coeffDst );
+	const typename T::V cs = T::set1( coeffSrc );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		T::store( d + i, T::add( T::mul( T::load( d + i ), cd ), T::mul( T::load( s + i ), cs ) ) );
+	}
+	for( ; i < n; ++i )
+	{
+		d[i] = d[i]*coeffDst + s[i]*coeffSrc;
+	}
+}
+
+
+
+template<class T>
+void sumWithVolumeAndPanning( sampleFrame* dst, const sampleFrame* const* srcs, int srcCount,
+				const float* volume, int volumeStride, const float* panning, int panningStride, int frames )
+{
+	float * d = samples( dst );
+	const int n = frames * DEFAULT_CHANNELS;
+	const typename T::V zero = T::set1( 0.0f );
+	const typename T::V one = T::set1( 1.0f );
+	const typename T::V percent = T::set1( 0.01f );
+	// min( 1, 1 - p ) for left and min( 1, 1 + p ) for right channel
+	const typename T::V side = T::stereo( -1.0f, 1.0f );
+	const typename T::V constVolume = T::mul( T::set1( volume[0] ), percent );
+	const typename T::V constPanning = T::mul( T::set1( panning[0] ), percent );
+
+	int i = 0;
+	for( ; i + T::Width <= n; i += T::Width )
+	{
+		typename T::V sum = zero;
+		for( int k = 0; k < srcCount; ++k )
+		{
+			sum = T::add( sum, T::load( samples( srcs[k] ) + i ) );
+		}
+		const typename T::V v = volumeStride ?
+				T::mul( T::perFrame( volume + i / 2 ), percent ) : constVolume;
+		const typename T::V p = panningStride ?
+				T::mul( T::perFrame( panning + i / 2 ), percent ) : constPanning;
+		const typename T::V gain = T::mul( T::min( one, T::add( one, T::mul( side, p ) ) ), v );
+		T::store( d + i, T::mul( sum, gain ) );
+	}
+	for( ; i < n; ++i )
+	{
+		const int f = i / 2;
+		float sum = 0.0f;
+		for( int k = 0; k < srcCount; ++k )
+		{
+			sum += srcs[k][f][i % 2];
+		}
+		const float v = volume[f * volumeStride] * 0.01f;
+		const float p = panning[f * panningStride] * 0.01f;
+		d[i] = sum * ( ( i % 2 ? ( p >= 0 ? 1.0f : 1.0f + p ) : ( p <= 0 ? 1.0f : 1.0f - p ) ) * v );
+	}
+}
+
+
+
+template<class T>
+constexpr Kernels makeKernels( const char * name )
+{
+	return Kernels {
+		name,
+		&isSilent<T>,
+		&sanitize<T>,
+		&add<T>,
+		&addMultiplied<T>,
+		&addMultipliedByBuffer<T>,
+		&addMultipliedByBuffers<T>,
+		&addSanitizedMultiplied<T>,
+		&addSanitizedMultipliedByBuffer<T>,
+		&addSanitizedMultipliedByBuffers<T>,
+		&addMultipliedStereo<T>,
+		&multiplyAndAddMultiplied<T>,
+		&sumWithVolumeAndPanning<T>
+	} ;
+}
+
+}
+}
+
+#endif
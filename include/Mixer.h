@@ -35,13 +35,14 @@
 #include "lmms_basics.h"
 #include "LocklessList.h"
 #include "Note.h"
-#include "fifo_buffer.h"
+#include "PeriodFifo.h"
 #include "MixerProfiler.h"
 
 
 class AudioDevice;
 class MidiClient;
 class AudioPort;
+class StemExporter;
 
 
 const fpp_t MINIMUM_BUFFER_SIZE = 32;
@@ -236,6 +237,19 @@ public:
 		return m_profiler.cpuLoad();
 	}
 
+	//! Number of threads rendering, including the mixer thread
+	int threadCount() const
+	{
+		return m_numWorkers + 1;
+	}
+
+	// allocation statistics of queue for newly added play handles - shows
+	// whether bursts of notes ran out of space
+	LocklessAllocator::Statistics newPlayHandlesStatistics() const
+	{
+		return m_newPlayHandles.allocatorStatistics();
+	}
+
 	const qualitySettings & currentQualitySettings() const
 	{
 		return m_qualitySettings;
@@ -295,16 +309,46 @@ public:
 		return m_inputBufferFrames[ m_inputBufferRead ];
 	}
 
+	// the returned buffer stays valid until the next call
 	inline const surroundSampleFrame * nextBuffer()
 	{
 		return hasFifoWriter() ? m_fifo->read() : renderNextBuffer();
 	}
 
+	PeriodFifo::Statistics fifoStatistics() const
+	{
+		return m_fifo->statistics();
+	}
+
+	//! Time periods spent in the fifo before the audio device took them
+	const LatencyHistogram & fifoLatency() const
+	{
+		return m_fifo->latency();
+	}
+
 	void changeQuality( const struct qualitySettings & _qs );
 
 	inline bool isMetronomeActive() const { return m_metronomeActive; }
 	inline void setMetronomeActive(bool value = true) { m_metronomeActive = value; }
 
+	// when exporting, render play-handles and process effects of audio
+	// ports in one pass instead of two separate stages
+	inline bool pipelinedRendering() const { return m_pipelinedRendering; }
+	inline void setPipelinedRendering(bool value = true) { m_pipelinedRendering = value; }
+
+	// hand the output of single tracks and FX channels to given exporter
+	// in every period, NULL to stop - must only be called by the thread
+	// rendering or while not processing
+	inline void setStemExporter( StemExporter * exporter ) { m_stemExporter = exporter; }
+
+	// returns true if given play-handle is going to be removed at the end
+	// of the current period, i.e. its output must not be mixed anymore
+	inline bool playHandleExpires( PlayHandle * handle ) const
+	{
+		return handle->isFinished() &&
+			( !handle->affinityMatters() || handle->affinity() == m_renderThread );
+	}
+
 	void requestChangeInModel();
 	void doneChangeInModel();
 
@@ -316,29 +360,28 @@ signals:
 
 
 private:
-	typedef fifoBuffer<surroundSampleFrame *> fifo;
-
 	class fifoWriter : public QThread
 	{
 	public:
-		fifoWriter( Mixer * _mixer, fifo * _fifo );
+		fifoWriter( Mixer * _mixer, PeriodFifo * _fifo );
 
 		void finish();
 
 
 	private:
 		Mixer * m_mixer;
-		fifo * m_fifo;
+		PeriodFifo * m_fifo;
 		volatile bool m_writing;
 
 		virtual void run();
 
-		void write( surroundSampleFrame * buffer );
+		// NULL marks the end of the stream
+		void write( const surroundSampleFrame * buffer );
 
 	} ;
 
 
-	Mixer( bool renderOnly );
+	Mixer( bool renderOnly, int threads );
 	virtual ~Mixer();
 
 	void startProcessing( bool _needs_fifo = true );
@@ -351,6 +394,8 @@ private:
 
 	const surroundSampleFrame * renderNextBuffer();
 
+	void removeFinishedPlayHandles();
+
 	void clearInternal();
 
 	void runChangesInModel();
@@ -402,12 +447,18 @@ private:
 	QString m_midiClientName;
 
 	// FIFO stuff
-	fifo * m_fifo;
+	PeriodFifo * m_fifo;
 	fifoWriter * m_fifoWriter;
 
 	MixerProfiler m_profiler;
 
 	bool m_metronomeActive;
+	bool m_pipelinedRendering;
+
+	StemExporter * m_stemExporter;
+
+	// thread currently rendering a period
+	const QThread * m_renderThread;
 
 	bool m_clearSignal;
 
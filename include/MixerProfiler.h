@@ -25,37 +25,299 @@
 #ifndef MIXER_PROFILER_H
 #define MIXER_PROFILER_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
 #include <QFile>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
 
 #include "lmms_basics.h"
 #include "MicroTimer.h"
 
+
+//! Counts durations in buckets of doubling width, can be fed from any thread
+class LatencyHistogram
+{
+public:
+	// bucket i counts durations below 2^i microseconds, the last one
+	// everything else
+	static const int Buckets = 20;
+
+	LatencyHistogram();
+
+	void add( int usecs );
+	void reset();
+
+	int count( int bucket ) const
+	{
+		return m_counts[bucket].load( std::memory_order_relaxed );
+	}
+
+	//! upper limit of a bucket in microseconds
+	static int bucketLimit( int bucket )
+	{
+		return 1 << bucket;
+	}
+
+	//! Upper limit of the bucket the given percentile of durations falls
+	//! into, 0 if nothing has been counted
+	static int percentile( const QVector<int> & counts, int percent );
+
+private:
+	std::atomic<int> m_counts[Buckets];
+
+} ;
+
+
+class QThread;
+class ThreadableJob;
+
+
 class MixerProfiler
 {
 public:
+	struct Latencies
+	{
+		QString name;
+		QVector<int> counts;
+	} ;
+
+	// stages of Mixer::renderNextBuffer() and the fifo writer
+	enum DetailType
+	{
+		Controllers,
+		SongProcessing,
+		PlayHandles,
+		Effects,
+		MasterMix,
+		FifoWrite,
+		DetailCount
+	} ;
+
 	MixerProfiler();
 	~MixerProfiler();
 
-	void startPeriod()
+	void startPeriod();
+	//! Periods which aren't played in real time (e.g. while exporting)
+	//! don't count as xruns, unless setOfflineXruns() was called
+	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod,
+							bool realtime );
+
+	//! Stage timing, only to be called from the mixer thread
+	void startDetail( DetailType type )
 	{
-		m_periodTimer.reset();
+		m_detailStart[type] = timestamp();
 	}
 
-	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod );
+	void finishDetail( DetailType type );
 
 	int cpuLoad() const
 	{
 		return m_cpuLoad;
 	}
 
+	//! Number of real-time periods which took longer than their budget
+	int xruns() const
+	{
+		return m_xruns.load( std::memory_order_relaxed );
+	}
+
+	//! Also check periods which aren't played in real time against their
+	//! budget, e.g. to find out whether a project rendered from the command
+	//! line would play without dropouts
+	void setOfflineXruns( bool enabled )
+	{
+		m_offlineXruns = enabled;
+	}
+
+	//! Keep timings of the given number of periods in the flight recorder
+	void setFlightRecorderDepth( int periods );
+
+	//! Append the flight recorder to the given file whenever a period takes
+	//! longer than factor times its real-time budget
+	void setXrunLog( const QString & logFile, float factor );
+
+	//! Write out a pending flight recorder snapshot, called by the writer
+	//! thread
+	void writeXrunSnapshot();
+
+	//! Write out the trace events of the periods finished since the last
+	//! call, called by the writer thread
+	void writeTraceBatches();
+
+	//! Time in microseconds the given stage took in the last period
+	int detailTime( DetailType type ) const
+	{
+		return m_detailTime[type].load( std::memory_order_relaxed );
+	}
+
+	static const char * detailName( DetailType type );
+
+	//! Has to be called before the worker threads are started
+	void setWorkerCount( int workers );
+
+	int workerCount() const
+	{
+		return m_workers.size();
+	}
+
+	//! Percentage of the last period the given worker spent in jobs
+	int workerLoad( int worker ) const
+	{
+		return m_workers[worker].utilisation.load( std::memory_order_relaxed );
+	}
+
+	//! Called by workers - the calling thread records into the given slot,
+	//! all other threads (i.e. the mixer thread) into the last one
+	static void setCurrentWorker( int worker );
+
+	//! Microseconds since the profiler was created
+	int64_t timestamp() const
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+				Clock::now() - m_epoch ).count();
+	}
+
+	//! Account a job which has been processed since start on the calling
+	//! thread
+	void finishJob( const ThreadableJob * job, int64_t start );
+
+	//! Record a span within a job (e.g. an effect) while tracing
+	void traceSpan( const char * category, const QString & name, int64_t start );
+
+	bool isTracing() const
+	{
+		return m_tracing.load( std::memory_order_relaxed );
+	}
+
 	void setOutputFile( const QString& outputFile );
 
+	//! Write stage and job timings as Chrome trace events to the given file
+	void setTraceFile( const QString& traceFile );
+
+	//! Histograms are listed by latencies() until they are removed again -
+	//! with an output file set, percentiles of all histograms which counted
+	//! anything are written to it when the profiler is destroyed
+	void addLatencyHistogram( const QString & name, const LatencyHistogram * histogram );
+	void removeLatencyHistogram( const LatencyHistogram * histogram );
+
+	//! Snapshot of all registered histograms
+	QList<Latencies> latencies() const;
+
 
 private:
-	MicroTimer m_periodTimer;
+	typedef std::chrono::steady_clock Clock;
+
+	struct TraceEvent
+	{
+		const char * category;
+		QString name;
+		int64_t start;
+		int duration;
+	} ;
+
+	// written only by the thread owning the slot while jobs are running,
+	// read by the mixer thread once all workers went idle
+	struct WorkerSlot
+	{
+		WorkerSlot() :
+			busy( 0 ),
+			utilisation( 0 ),
+			numEvents( 0 ),
+			droppedEvents( 0 )
+		{
+		}
+
+		WorkerSlot( const WorkerSlot & other ) :
+			WorkerSlot()
+		{
+			Q_UNUSED( other );
+		}
+
+		std::atomic<int> busy;
+		std::atomic<int> utilisation;
+		std::vector<TraceEvent> events;
+		int numEvents;
+		int droppedEvents;
+		char pad[64];
+	} ;
+
+	// trace events of all workers in a period, handed over to the writer
+	// thread by swapping the vectors of the worker slots with the ones in
+	// here
+	struct TraceBatch
+	{
+		std::vector<std::vector<TraceEvent> > events;
+		std::vector<int> numEvents;
+		std::vector<int> droppedEvents;
+	} ;
+
+	// timings of a single period as kept by the flight recorder
+	struct PeriodRecord
+	{
+		int64_t start;
+		int elapsed;
+		int budget;
+		int details[DetailCount];
+	} ;
+
+	void recordPeriod( int64_t start, int elapsed, int budget, bool realtime );
+
+	WorkerSlot & currentSlot();
+	void record( WorkerSlot & slot, const char * category,
+					const QString & name, int64_t start, int duration );
+	void queueTrace();
+	void closeTrace();
+	void writeLatencies();
+
+	const Clock::time_point m_epoch;
+	int64_t m_periodStart;
 	int m_cpuLoad;
 	QFile m_outputFile;
 
+	int64_t m_detailStart[DetailCount];
+	std::atomic<int> m_detailTime[DetailCount];
+
+	std::vector<WorkerSlot> m_workers;
+
+	std::atomic<int> m_xruns;
+	bool m_offlineXruns;
+
+	// ring of the last periods, only touched by the mixer thread - on an
+	// overrun it's copied in order to m_snapshot which then is owned by
+	// the writer thread until it resets m_snapshotPending
+	std::vector<PeriodRecord> m_flightRecorder;
+	int m_flightRecorderPos;
+	int m_flightRecorderSize;
+	std::vector<PeriodRecord> m_snapshot;
+	int m_snapshotSize;
+	std::atomic_bool m_snapshotPending;
+	float m_xrunLogFactor;
+	QFile m_xrunLog;
+	QThread * m_xrunLogWriter;
+
+	std::atomic_bool m_tracing;
+	QFile m_traceFile;
+	bool m_firstTraceEvent;
+
+	// ring of batches - the mixer thread fills them in order and the
+	// writer thread follows, both counters only ever grow
+	std::vector<TraceBatch> m_traceBatches;
+	std::atomic<int64_t> m_traceBatchesQueued;
+	std::atomic<int64_t> m_traceBatchesWritten;
+	std::atomic<int> m_droppedTracePeriods;
+	QThread * m_traceWriter;
+
+	mutable QMutex m_histogramsMutex;
+	QList<QPair<QString, const LatencyHistogram *> > m_histograms;
+	// snapshots of histograms which have been removed already
+	QList<Latencies> m_removedLatencies;
+
 };
 
 #endif
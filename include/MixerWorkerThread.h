@@ -25,18 +25,78 @@
 #ifndef MIXER_WORKER_THREAD_H
 #define MIXER_WORKER_THREAD_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 
 #include <atomic>
+#include <cstdint>
 
-class QWaitCondition;
 class Mixer;
+class MixerProfiler;
 class ThreadableJob;
 
 class MixerWorkerThread : public QThread
 {
 	Q_OBJECT
 public:
+	// park/unpark primitive: unpark() leaves a token which makes the next
+	// (or a currently blocking) call to park() return - this way a wakeup
+	// can never get lost, no matter in which order both calls happen
+	class Parker
+	{
+	public:
+		Parker() :
+			m_state( Empty )
+		{
+		}
+
+		void park();
+		void unpark();
+
+	private:
+		enum State
+		{
+			Empty,
+			Parked,
+			Notified
+		} ;
+
+		std::atomic_int m_state;
+		QMutex m_mutex;
+		QWaitCondition m_cond;
+
+	} ;
+
+
+	// bounded Chase-Lev work-stealing deque - push() and pop() may only be
+	// called by the owning thread, steal() by any thread
+	class JobDeque
+	{
+	public:
+#define JOB_QUEUE_SIZE 8192
+		JobDeque() :
+			m_top( 0 ),
+			m_bottom( 0 )
+		{
+			std::fill(m_items, m_items + JOB_QUEUE_SIZE, nullptr);
+		}
+
+		bool push( ThreadableJob * _job );
+		ThreadableJob * pop();
+		ThreadableJob * steal();
+
+	private:
+		// keep indices of owner and thieves on separate cache lines
+		std::atomic<int64_t> m_top;
+		char m_pad0[64 - sizeof( std::atomic<int64_t> )];
+		std::atomic<int64_t> m_bottom;
+		char m_pad1[64 - sizeof( std::atomic<int64_t> )];
+		std::atomic<ThreadableJob*> m_items[JOB_QUEUE_SIZE];
+
+	} ;
+
+
 	// internal representation of the job queue - all functions are thread-safe
 	class JobQueue
 	{
@@ -47,29 +107,45 @@ public:
 			Dynamic	// jobs can be added while processing queue
 		} ;
 
-#define JOB_QUEUE_SIZE 8192
 		JobQueue() :
-			m_items(),
-			m_writeIndex( 0 ),
-			m_itemsDone( 0 ),
+			m_pending( 0 ),
+			m_activeWorkers( 0 ),
+			m_seeded( 0 ),
+			m_running( false ),
 			m_opMode( Static )
 		{
-			std::fill(m_items, m_items + JOB_QUEUE_SIZE, nullptr);
 		}
 
 		void reset( OperationMode _opMode );
 
 		void addJob( ThreadableJob * _job );
 
-		void run();
-		void wait();
+		// wake up as many workers as there are jobs queued and help
+		// processing until all jobs (including the ones added while
+		// processing) are done and all woken workers went idle again
+		void runAndWait();
+
+		// process jobs from own deque and steal from others until there's
+		// nothing left to do
+		void run( MixerWorkerThread * _self );
+
+		void workerIdle();
 
 	private:
-		std::atomic<ThreadableJob*> m_items[JOB_QUEUE_SIZE];
-		std::atomic_int m_writeIndex;
-		std::atomic_int m_itemsDone;
+		ThreadableJob * steal( MixerWorkerThread * _self );
+		// unpark one worker which isn't processing jobs at the moment
+		void wakeIdleWorker();
+		void jobDone();
+
+		std::atomic_int m_pending;
+		std::atomic_int m_activeWorkers;
+		int m_seeded;
+		std::atomic_bool m_running;
 		OperationMode m_opMode;
 
+		// the thread calling runAndWait() parks here
+		Parker m_waiter;
+
 	} ;
 
 
@@ -108,11 +184,23 @@ public:
 private:
 	virtual void run();
 
+	// returns the worker whose deque the calling thread owns - threads
+	// which are no worker threads (i.e. the mixer thread) use the last
+	// worker which is never started
+	static MixerWorkerThread * currentWorker();
+
 	static JobQueue globalJobQueue;
-	static QWaitCondition * queueReadyWaitCond;
+	static MixerProfiler * profiler;
 	static QList<MixerWorkerThread *> workerThreads;
 
-	volatile bool m_quit;
+	const int m_index;
+	JobDeque m_jobs;
+	Parker m_parker;
+	std::atomic_bool m_hasWork;
+	// set while the worker has been woken up for the current period and
+	// hasn't gone idle yet
+	std::atomic_bool m_busy;
+	std::atomic_bool m_quit;
 
 } ;
 
@@ -34,7 +34,6 @@
 #include "Track.h"
 #include "MemoryManager.h"
 
-class QReadWriteLock;
 class InstrumentTrack;
 class NotePlayHandle;
 
@@ -107,6 +106,10 @@ public:
 	/*! Renders one chunk using the attached instrument into the buffer */
 	virtual void play( sampleFrame* buffer );
 
+	/*! Returns whether play() might send MIDI events in the current period,
+	    i.e. a note-off or note-ons of arpeggio and chord sub-notes */
+	bool sendsEventsThisPeriod() const;
+
 	/*! Returns whether playback of note is finished and thus handle can be deleted */
 	virtual bool isFinished() const
 	{
@@ -329,8 +332,12 @@ private:
 
 
 const int INITIAL_NPH_CACHE = 256;
-const int NPH_CACHE_INCREMENT = 16;
+// the pool grows in chunks of this size
+const int NPH_CACHE_INCREMENT = 64;
 
+// Lock-free pool of NotePlayHandles. Every thread keeps a few free handles
+// on its own and exchanges them in batches with a global free list. Growing
+// the pool just publishes a new chunk, so it never blocks other threads.
 class NotePlayHandleManager
 {
 	MM_OPERATORS
@@ -345,12 +352,6 @@ public:
 					NotePlayHandle::Origin origin = NotePlayHandle::OriginPattern );
 	static void release( NotePlayHandle * nph );
 	static void extend( int i );
-
-private:
-	static NotePlayHandle ** s_available;
-	static QReadWriteLock s_mutex;
-	static std::atomic_int s_availableIndex;
-	static int s_size;
 };
 
 
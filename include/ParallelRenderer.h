@@ -0,0 +1,116 @@
+/*
+ * ParallelRenderer.h - renders sections of a song in separate processes and
+ *                      stitches them together
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PARALLEL_RENDERER_H
+#define PARALLEL_RENDERER_H
+
+#include <vector>
+
+#include <QtCore/QObject>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryDir>
+
+#include <sndfile.h>
+
+#include "OutputSettings.h"
+#include "ProjectRenderer.h"
+
+
+//! Splits the song into sections at tact boundaries and renders each of them
+//! with an LMMS process of its own. The engine only exists once per process,
+//! so this is the way to use more cores than a single mixer can keep busy.
+//! Every section is played from a few tacts ahead of its beginning so that
+//! notes and effect tails which cross the boundary are in place, and goes on
+//! a little past its end. The sections are crossfaded over that overlap,
+//! which is also compared - the render fails if they don't match, as the
+//! preroll has been too short then. Sections which turn out to be a frame
+//! apart get aligned before crossfading.
+class ParallelRenderer : public QObject
+{
+	Q_OBJECT
+public:
+	//! renderArgs are passed on to the processes, e.g. quality settings
+	ParallelRenderer( const QString & projectFile,
+				const QStringList & renderArgs,
+				const OutputSettings & outputSettings,
+				ProjectRenderer::ExportFileFormats format,
+				const QString & outputPath,
+				int sections, int prerollTacts,
+				QObject * parent = NULL );
+	virtual ~ParallelRenderer();
+
+	//! Split the loaded song and launch the processes
+	void start();
+
+
+public slots:
+	void updateConsoleProgress();
+
+
+signals:
+	//! Emitted with EXIT_SUCCESS once the output has been written
+	void finished( int exitCode );
+
+
+private slots:
+	void sectionFinished( int exitCode, QProcess::ExitStatus exitStatus );
+	void sectionFailed( QProcess::ProcessError error );
+
+
+private:
+	struct Section
+	{
+		ProjectRenderer::Section range;
+		QString path;
+		QProcess * process;
+	} ;
+
+	void abort( const QString & message );
+	bool stitch();
+	f_cnt_t readFrames( SNDFILE * file, int channels,
+				surroundSampleFrame * dst, f_cnt_t frames );
+	float compareOverlap( const surroundSampleFrame * a,
+				const surroundSampleFrame * b, f_cnt_t frames,
+				int & shift );
+
+	const QString m_projectFile;
+	const QStringList m_renderArgs;
+	const OutputSettings m_outputSettings;
+	const ProjectRenderer::ExportFileFormats m_format;
+	const QString m_outputPath;
+	const int m_numSections;
+	const int m_prerollTacts;
+
+	QTemporaryDir m_tempDir;
+	std::vector<Section> m_sections;
+	int m_sectionsDone;
+	bool m_aborted;
+
+	// overlap of the sections at the output sample rate
+	f_cnt_t m_overlap;
+	std::vector<float> m_readBuffer;
+
+} ;
+
+#endif
@@ -79,6 +79,11 @@ public:
 		return m_notes;
 	}
 
+	// returns the first note which doesn't start before given position -
+	// remembers the result so that successive calls while playing are
+	// (amortised) constant time, has to be called with the track locked
+	NoteVector::ConstIterator firstNoteFrom( const MidiTime & pos ) const;
+
 	Note * addStepNote( int step );
 	void setStep( int step, bool enabled );
 
@@ -143,6 +148,9 @@ private:
 	NoteVector m_notes;
 	int m_steps;
 
+	// index of note last returned by firstNoteFrom()
+	mutable int m_playCursor;
+
 	Pattern * adjacentPatternByOffset(int offset) const;
 
 	friend class PatternView;
@@ -64,6 +64,7 @@ public slots:
 protected:
 	// The internal per-controller get-value function
 	virtual void updateValueBuffer();
+	virtual void addDependencies();
 
 	PeakControllerEffect * m_peakEffect;
 
@@ -0,0 +1,111 @@
+/*
+ * PeriodFifo.h - ring of preallocated period buffers between the mixer's
+ *                fifo writer and the audio device
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PERIOD_FIFO_H
+#define PERIOD_FIFO_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "lmms_basics.h"
+#include "MixerProfiler.h"
+#include "MixerWorkerThread.h"
+
+
+// Single producer, single consumer queue of rendered periods. All buffers
+// are allocated up front and reused, indices are handed over through
+// atomics - a side only touches a mutex when the other one is sleeping.
+class PeriodFifo
+{
+public:
+	struct Statistics
+	{
+		int depth;
+		// periods ready to be read
+		int fillLevel;
+		// times the reader had to wait for a period
+		int underruns;
+		// times the writer had to wait for a free buffer
+		int writerWaits;
+	} ;
+
+	PeriodFifo( int depth, fpp_t framesPerPeriod );
+	~PeriodFifo();
+
+	// returns the buffer to put the next period into - blocks while
+	// all buffers are queued or being read
+	surroundSampleFrame * beginWrite();
+	// queue the buffer returned by beginWrite(), endOfStream makes the
+	// reader get NULL instead of it
+	void endWrite( bool endOfStream = false );
+
+	// returns the next period or NULL at the end of the stream - the
+	// buffer stays valid until the next call
+	const surroundSampleFrame * read();
+
+	Statistics statistics() const;
+
+	// time periods spent in the queue
+	const LatencyHistogram & latency() const
+	{
+		return m_latency;
+	}
+
+
+private:
+	struct Slot
+	{
+		surroundSampleFrame * buffer;
+		int64_t queued;
+		bool endOfStream;
+	} ;
+
+	int64_t now() const;
+
+	const int m_depth;
+	// one more slot than periods queued, held by the reader
+	const int m_numSlots;
+	const fpp_t m_framesPerPeriod;
+	Slot * m_slots;
+
+	// number of periods queued by the writer
+	std::atomic<int64_t> m_written;
+	char m_pad0[64 - sizeof( std::atomic<int64_t> )];
+	// number of periods the reader is done with
+	std::atomic<int64_t> m_released;
+	char m_pad1[64 - sizeof( std::atomic<int64_t> )];
+	// only touched by the reader
+	int64_t m_read;
+	bool m_holding;
+
+	MixerWorkerThread::Parker m_writerParker;
+	MixerWorkerThread::Parker m_readerParker;
+
+	std::atomic<int> m_underruns;
+	std::atomic<int> m_writerWaits;
+	LatencyHistogram m_latency;
+
+} ;
+
+
+#endif
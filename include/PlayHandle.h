@@ -94,6 +94,14 @@ public:
 		return !isFinished();
 	}
 
+	virtual const char * jobCategory() const
+	{
+		return "PlayHandle";
+	}
+
+	// named after the audio port (i.e. the track) we're rendering to
+	virtual QString jobName() const;
+
 	void lock()
 	{
 		m_processingLock.lock();
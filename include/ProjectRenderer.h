@@ -27,11 +27,14 @@
 
 #include "AudioFileDevice.h"
 #include "lmmsconfig.h"
+#include "MidiTime.h"
 #include "Mixer.h"
 #include "OutputSettings.h"
 
 #include "lmms_export.h"
 
+class StemExporter;
+
 class LMMS_EXPORT ProjectRenderer : public QThread
 {
 	Q_OBJECT
@@ -55,6 +58,19 @@ public:
 		AudioFileDeviceInstantiaton m_getDevInst;
 	} ;
 
+	// part of the song rendered by one process of a parallel render - the
+	// song is played from preroll ticks ahead of begin on so that notes and
+	// effect tails can build up, but only the frames from begin on are
+	// written, followed by overlap frames (at the sample rate of the file)
+	// past end to crossfade with the next section
+	struct Section
+	{
+		tick_t begin;
+		tick_t end;
+		tick_t preroll;
+		f_cnt_t overlap;
+	} ;
+
 
 	ProjectRenderer( const Mixer::qualitySettings & _qs,
 				const OutputSettings & _os,
@@ -67,6 +83,20 @@ public:
 		return m_fileDev != NULL;
 	}
 
+	// also write stems while rendering - has to be set before
+	// startProcessing()
+	void setStemExporter( StemExporter * exporter )
+	{
+		m_stemExporter = exporter;
+	}
+
+	// render a section only - has to be set before startProcessing()
+	void setSection( const Section & section )
+	{
+		m_section = section;
+		m_renderSection = true;
+	}
+
 	static ExportFileFormats getFileFormatFromExtension(
 							const QString & _ext );
 
@@ -89,6 +119,9 @@ private:
 	virtual void run();
 
 	AudioFileDevice * m_fileDev;
+	StemExporter * m_stemExporter;
+	Section m_section;
+	bool m_renderSection;
 	Mixer::qualitySettings m_qualitySettings;
 
 	volatile int m_progress;
@@ -28,6 +28,7 @@
 #include "MidiEvent.h"
 #include "VstSyncData.h"
 
+#include <algorithm>
 #include <atomic>
 #include <vector>
 #include <cstdio>
@@ -49,6 +50,20 @@
 #include <QtCore/QSystemSemaphore>
 #endif
 
+// on Linux messages are passed through rings in shared memory instead of
+// a socket, see shmRing
+#if !defined(SYNC_WITH_SHM_FIFO) && defined(LMMS_BUILD_LINUX) && \
+	defined(LMMS_HAVE_SYS_SHM_H)
+#define SYNC_WITH_SHM_RING
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <signal.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 
 #ifdef LMMS_HAVE_SYS_SHM_H
 #include <sys/shm.h>
@@ -89,6 +104,7 @@ typedef int32_t key_t;
 
 #else
 #include "lmms_export.h"
+#include "MixerProfiler.h"
 #include <QtCore/QMutex>
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
@@ -412,6 +428,228 @@ private:
 
 
 
+#ifdef SYNC_WITH_SHM_RING
+// size of each direction - bigger messages (e.g. VST parameter dumps) are
+// streamed through while the other side reads them
+const uint32_t SHM_RING_SIZE = 64*1024;
+
+// rounds to check for data before going to sleep - the plugin usually
+// answers IdStartProcessing within a few microseconds
+const int SHM_RING_SPIN_ROUNDS = 4096;
+
+
+// single-producer single-consumer byte ring inside a shared memory segment.
+// A waiting side sleeps on a futex and is only woken if it actually sleeps,
+// so passing messages usually doesn't enter the kernel at all. Written data
+// is published by flush(), which makes a message arrive in one piece.
+class shmRing
+{
+public:
+	// lives in shared memory - must look the same for 32 and 64 bit
+	// processes, so only use fixed-size types here
+	struct shmData
+	{
+		std::atomic<uint32_t> written;	// bytes published by the writer
+		std::atomic<uint32_t> read;	// bytes consumed by the reader
+		std::atomic<int32_t> readerSleeping;
+		std::atomic<int32_t> writerSleeping;
+		std::atomic<int32_t> invalid;
+		char buffer[SHM_RING_SIZE];
+	} ;
+
+	// both directions as allocated by the host
+	struct shmPair
+	{
+		shmData toClient;
+		shmData toHost;
+	} ;
+
+	shmRing() :
+		m_data( NULL ),
+		m_written( 0 ),
+		m_peer( 0 )
+	{
+	}
+
+	void attach( shmData * data )
+	{
+		m_data = data;
+		m_written = data ? data->written.load() : 0;
+	}
+
+	// process on the other side - if set, waiting checks from time to
+	// time whether it still exists
+	void setPeer( pid_t peer )
+	{
+		m_peer = peer;
+	}
+
+	inline bool isInvalid() const
+	{
+		return m_data == NULL || m_data->invalid.load( std::memory_order_relaxed );
+	}
+
+	void invalidate()
+	{
+		if( m_data )
+		{
+			m_data->invalid = 1;
+			futexWake( &m_data->written );
+			futexWake( &m_data->read );
+		}
+	}
+
+	inline bool messagesLeft() const
+	{
+		return m_data &&
+			m_data->written.load( std::memory_order_acquire ) !=
+				m_data->read.load( std::memory_order_relaxed );
+	}
+
+	// reads exactly len bytes, waits for the writer if necessary -
+	// returns false and zeroes the buffer if the ring got invalid
+	bool read( void * buf, int len )
+	{
+		char * dst = (char *) buf;
+		while( len > 0 )
+		{
+			const uint32_t available = waitForData();
+			if( available == 0 )
+			{
+				memset( dst, 0, len );
+				return false;
+			}
+			const uint32_t read = m_data->read.load( std::memory_order_relaxed );
+			const uint32_t pos = read % SHM_RING_SIZE;
+			const uint32_t n = std::min<uint32_t>( std::min<uint32_t>(
+						len, available ), SHM_RING_SIZE - pos );
+			memcpy( dst, m_data->buffer + pos, n );
+			dst += n;
+			len -= n;
+
+			m_data->read.store( read + n );
+			if( m_data->writerSleeping.load() )
+			{
+				futexWake( &m_data->read );
+			}
+		}
+		return true;
+	}
+
+	// writes len bytes, they become visible to the reader with the next
+	// flush() - only waits if the ring is full
+	void write( const void * buf, int len )
+	{
+		const char * src = (const char *) buf;
+		while( len > 0 && !isInvalid() )
+		{
+			const uint32_t free = SHM_RING_SIZE - ( m_written -
+				m_data->read.load( std::memory_order_acquire ) );
+			if( free == 0 )
+			{
+				flush();
+				waitForSpace();
+				continue;
+			}
+			const uint32_t pos = m_written % SHM_RING_SIZE;
+			const uint32_t n = std::min<uint32_t>( std::min<uint32_t>(
+						len, free ), SHM_RING_SIZE - pos );
+			memcpy( m_data->buffer + pos, src, n );
+			src += n;
+			len -= n;
+			m_written += n;
+		}
+	}
+
+	void flush()
+	{
+		if( m_data == NULL )
+		{
+			return;
+		}
+		m_data->written.store( m_written );
+		if( m_data->readerSleeping.load() )
+		{
+			futexWake( &m_data->written );
+		}
+	}
+
+
+private:
+	static void futexWait( std::atomic<uint32_t> * word, uint32_t value )
+	{
+		// wake up from time to time to see whether the peer still exists
+		struct timespec timeout = { 1, 0 };
+		syscall( SYS_futex, reinterpret_cast<uint32_t *>( word ),
+					FUTEX_WAIT, value, &timeout, NULL, 0 );
+	}
+
+	static void futexWake( std::atomic<uint32_t> * word )
+	{
+		syscall( SYS_futex, reinterpret_cast<uint32_t *>( word ),
+					FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+	}
+
+	void checkPeer()
+	{
+		if( m_peer && kill( m_peer, 0 ) == -1 && errno == ESRCH )
+		{
+			invalidate();
+		}
+	}
+
+	// returns number of readable bytes, 0 if the ring got invalid
+	uint32_t waitForData()
+	{
+		const uint32_t read = m_data ? m_data->read.load( std::memory_order_relaxed ) : 0;
+		int spins = 0;
+		uint32_t written = read;
+		while( !isInvalid() &&
+			( written = m_data->written.load( std::memory_order_acquire ) ) == read )
+		{
+			if( ++spins < SHM_RING_SPIN_ROUNDS )
+			{
+				continue;
+			}
+			// the writer checks readerSleeping after publishing, so
+			// either it sees the flag or we see the new data
+			m_data->readerSleeping = 1;
+			if( m_data->written.load() == read && !isInvalid() )
+			{
+				futexWait( &m_data->written, read );
+				checkPeer();
+			}
+			m_data->readerSleeping = 0;
+		}
+		return isInvalid() ? 0 : written - read;
+	}
+
+	void waitForSpace()
+	{
+		const uint32_t read = m_data->read.load( std::memory_order_acquire );
+		if( m_written - read < SHM_RING_SIZE || isInvalid() )
+		{
+			return;
+		}
+		m_data->writerSleeping = 1;
+		if( m_data->read.load() == read && !isInvalid() )
+		{
+			futexWait( &m_data->read, read );
+			checkPeer();
+		}
+		m_data->writerSleeping = 0;
+	}
+
+	shmData * m_data;
+	// bytes written including the ones not flushed yet
+	uint32_t m_written;
+	pid_t m_peer;
+
+} ;
+#endif
+
+
+
 enum RemoteMessageIDs
 {
 	IdUndefined,
@@ -549,6 +787,8 @@ public:
 	{
 #ifdef SYNC_WITH_SHM_FIFO
 		return m_in->isInvalid() || m_out->isInvalid();
+#elif defined(SYNC_WITH_SHM_RING)
+		return m_invalid || m_in.isInvalid() || m_out.isInvalid();
 #else
 		return m_invalid;
 #endif
@@ -606,6 +846,8 @@ public:
 	{
 #ifdef SYNC_WITH_SHM_FIFO
 		return m_in->messagesLeft();
+#elif defined(SYNC_WITH_SHM_RING)
+		return m_in.messagesLeft();
 #else
 		struct pollfd pollin;
 		pollin.fd = m_socket;
@@ -657,11 +899,18 @@ protected:
 		m_in->messageSent();
 #else
 		m_invalid = true;
+#ifdef SYNC_WITH_SHM_RING
+		m_in.invalidate();
+		m_out.invalidate();
+#endif
 #endif
 	}
 
 
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+	shmRing m_in;
+	shmRing m_out;
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	int m_socket;
 #endif
 
@@ -678,6 +927,23 @@ private:
 #ifdef SYNC_WITH_SHM_FIFO
 	shmFifo * m_in;
 	shmFifo * m_out;
+#else
+#ifdef SYNC_WITH_SHM_RING
+	void read( void * _buf, int _len )
+	{
+		if( isInvalid() || !m_in.read( _buf, _len ) )
+		{
+			memset( _buf, 0, _len );
+		}
+	}
+
+	void write( const void * _buf, int _len )
+	{
+		if( !isInvalid() )
+		{
+			m_out.write( _buf, _len );
+		}
+	}
 #else
 	void read( void * _buf, int _len )
 	{
@@ -730,6 +996,7 @@ private:
 			remaining -= nwritten;
 		}
 	}
+#endif
 
 
 	bool m_invalid;
@@ -801,6 +1068,24 @@ public:
 
 	bool process( const sampleFrame * _in_buf, sampleFrame * _out_buf );
 
+	// split-phase processing: startProcessing() hands the input over and
+	// returns right away so that the plugin can work while the caller does
+	// something else, finishProcessing() waits for the plugin and fetches
+	// the output - process() does both at once if nothing was started
+	bool startProcessing( const sampleFrame * _in_buf );
+	bool finishProcessing( sampleFrame * _out_buf );
+
+	inline bool isProcessing() const
+	{
+		return m_processing;
+	}
+
+	//! time from handing over the input until the output was fetched
+	const LatencyHistogram & latency() const
+	{
+		return m_latency;
+	}
+
 	void processMidiEvent( const MidiEvent&, const f_cnt_t _offset );
 
 	void updateSampleRate( sample_rate_t _sr )
@@ -875,7 +1160,15 @@ private:
 	int m_inputCount;
 	int m_outputCount;
 
-#ifndef SYNC_WITH_SHM_FIFO
+	bool m_processing;
+	std::atomic<bool> m_processingDone;
+	MicroTimer m_processingTimer;
+	LatencyHistogram m_latency;
+
+#ifdef SYNC_WITH_SHM_RING
+	int m_ringsID;
+	shmRing::shmPair * m_rings;
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	int m_server;
 	QString m_socketFile;
 #endif
@@ -984,6 +1277,9 @@ private:
 #endif
 	VstSyncData * m_vstSyncData;
 	float * m_shm;
+#ifdef SYNC_WITH_SHM_RING
+	shmRing::shmPair * m_rings;
+#endif
 
 	int m_inputCount;
 	int m_outputCount;
@@ -1010,6 +1306,11 @@ private:
 RemotePluginBase::RemotePluginBase( shmFifo * _in, shmFifo * _out ) :
 	m_in( _in ),
 	m_out( _out )
+#elif defined(SYNC_WITH_SHM_RING)
+RemotePluginBase::RemotePluginBase() :
+	m_in(),
+	m_out(),
+	m_invalid( false )
 #else
 RemotePluginBase::RemotePluginBase() :
 	m_socket( -1 ),
@@ -1068,6 +1369,10 @@ int RemotePluginBase::sendMessage( const message & _m )
 		writeString( _m.data[i] );
 		j += 4 + _m.data[i].size();
 	}
+#ifdef SYNC_WITH_SHM_RING
+	// let the whole message arrive at once
+	m_out.flush();
+#endif
 	pthread_mutex_unlock( &m_sendMutex );
 #endif
 
@@ -1187,12 +1492,32 @@ RemotePluginClient::RemotePluginClient( const char * socketPath ) :
 #endif
 	m_vstSyncData( NULL ),
 	m_shm( NULL ),
+#ifdef SYNC_WITH_SHM_RING
+	m_rings( NULL ),
+#endif
 	m_inputCount( 0 ),
 	m_outputCount( 0 ),
 	m_sampleRate( 44100 ),
 	m_bufferSize( 0 )
 {
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+	// the host passes the ID of the segment holding the message rings
+	// instead of a socket path
+	m_rings = (shmRing::shmPair *) shmat( atoi( socketPath ), 0, 0 );
+	if( m_rings == (shmRing::shmPair *)( -1 ) )
+	{
+		perror( "RemotePluginClient::shmat" );
+		m_rings = NULL;
+		invalidate();
+	}
+	else
+	{
+		m_in.attach( &m_rings->toClient );
+		m_out.attach( &m_rings->toHost );
+		m_in.setPeer( getppid() );
+		m_out.setPeer( getppid() );
+	}
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	struct sockaddr_un sa;
 	sa.sun_family = AF_LOCAL;
 
@@ -1288,7 +1613,14 @@ RemotePluginClient::~RemotePluginClient()
 	shmdt( m_shm );
 #endif
 
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+	m_in.attach( NULL );
+	m_out.attach( NULL );
+	if( m_rings != NULL )
+	{
+		shmdt( m_rings );
+	}
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	if ( close( m_socket ) == -1)
 	{
 		fprintf( stderr, "Error freeing resources.\n" );
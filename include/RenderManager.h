@@ -31,6 +31,9 @@
 #include "ProjectRenderer.h"
 #include "OutputSettings.h"
 
+class FxChannel;
+class StemExporter;
+
 
 class RenderManager : public QObject
 {
@@ -47,8 +50,12 @@ public:
 	/// Export all unmuted tracks into a single file
 	void renderProject();
 
-	/// Export all unmuted tracks into individual file
-	void renderTracks();
+	/// Export all unmuted tracks into individual files, rendering the song
+	/// only once - optionally the FX channels as well
+	void renderTracks( bool includeFxChannels = false );
+
+	/// Only render a section of the song, see ProjectRenderer::Section
+	void setSection( const ProjectRenderer::Section & section );
 
 	void abortProcessing();
 
@@ -57,12 +64,15 @@ signals:
 	void finished();
 
 private slots:
-	void renderNextTrack();
+	void renderFinished();
 	void updateConsoleProgress();
 
 private:
 	QString pathForTrack( const Track *track, int num );
-	void restoreMutedState();
+	QString pathForFxChannel( const FxChannel *channel, int num );
+	AudioFileDevice * createFileDevice( const QString & path );
+	static AudioPort * audioPortOf( Track * track );
+	void finishStems( bool discard );
 
 	void render( QString outputPath );
 
@@ -71,11 +81,11 @@ private:
 	const OutputSettings m_outputSettings;
 	ProjectRenderer::ExportFileFormats m_format;
 	QString m_outputPath;
+	ProjectRenderer::Section m_section;
+	bool m_renderSection;
 
 	std::unique_ptr<ProjectRenderer> m_activeRenderer;
-
-	QVector<Track*> m_tracksToRender;
-	QVector<Track*> m_unmuted;
+	std::unique_ptr<StemExporter> m_stemExporter;
 } ;
 
 #endif
@@ -41,6 +41,7 @@
 
 class QPainter;
 class QRect;
+class SampleCacheFile;
 
 // values for buffer margins, used for various libsamplerate interpolation modes
 // the array positions correspond to the converter_type parameter values in libsamplerate
@@ -266,6 +267,9 @@ public slots:
 
 private:
 	void update( bool _keep_settings = false );
+	// frees the sample data - a cache file is handed back to the caller
+	// instead, so that it can be deleted without holding off the mixer
+	SampleCacheFile * releaseData();
 
 	void convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels);
 	void directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels);
@@ -286,6 +290,8 @@ private:
 	sampleFrame * m_origData;
 	f_cnt_t m_origFrames;
 	sampleFrame * m_data;
+	// set if m_data is mapped from a cache file instead of being allocated
+	SampleCacheFile * m_cacheFile;
 	QReadWriteLock m_varLock;
 	f_cnt_t m_frames;
 	f_cnt_t m_startFrame;
@@ -0,0 +1,86 @@
+/*
+ * SampleCacheFile.h - decoded samples in a memory mapped cache file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_CACHE_FILE_H
+#define SAMPLE_CACHE_FILE_H
+
+#include <memory>
+
+#include <QtCore/QString>
+
+#include "lmms_basics.h"
+
+
+//! Holds a long sample decoded as float frames in a file in the cache
+//! directory, which is mapped into memory instead of being loaded. The
+//! system only keeps the parts which are in use in memory, and a sample
+//! which has been decoded once maps instantly afterwards. Pages ahead of
+//! the play position are read in by a background thread, so that the mixer
+//! doesn't have to wait for the disk.
+class SampleCacheFile
+{
+public:
+	//! Decode audioFile at the given sample rate unless there's an up to
+	//! date cache file already, and map it - returns NULL if libsndfile
+	//! can't read the file or the cache can't be written. Decoding takes
+	//! a while, so don't call this while holding off the mixer.
+	static SampleCacheFile * open( const QString & audioFile,
+				sample_rate_t sampleRate, bool reversed );
+	~SampleCacheFile();
+
+	sampleFrame * data() const
+	{
+		return m_data;
+	}
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	//! Called by the mixer while playing - doesn't block
+	void prefetch( f_cnt_t frame );
+
+
+private:
+	class Prefetcher;
+	// the mapped file along with the prefetch position - shared with the
+	// prefetcher, so that it can read in pages without holding a lock we'd
+	// have to wait for when going away
+	struct Mapping;
+
+	SampleCacheFile( const QString & path, sample_rate_t sampleRate );
+
+	static QString cachePath( const QString & audioFile,
+				sample_rate_t sampleRate, bool reversed );
+	static bool decode( const QString & audioFile, const QString & path,
+				sample_rate_t sampleRate, bool reversed );
+	static void trimCache( const QString & dir, const QString & keep );
+
+	std::shared_ptr<Mapping> m_mapping;
+	sampleFrame * m_data;
+	f_cnt_t m_frames;
+
+} ;
+
+
+#endif
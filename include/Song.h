@@ -26,10 +26,13 @@
 #define SONG_H
 
 #include <utility>
+#include <vector>
 
+#include <QtCore/QSet>
 #include <QtCore/QSharedMemory>
 #include <QtCore/QVector>
 
+#include "AutomationCursor.h"
 #include "TrackContainer.h"
 #include "Controller.h"
 #include "MeterModel.h"
@@ -203,6 +206,15 @@ public:
 		m_renderBetweenMarkers = renderBetweenMarkers;
 	}
 
+	// export the given range only, e.g. one section of a parallel render -
+	// takes precedence over the markers and the export loop setting
+	inline void setExportRange( const MidiTime & begin, const MidiTime & end )
+	{
+		m_exportRange = true;
+		m_exportRangeBegin = begin;
+		m_exportRangeEnd = end;
+	}
+
 	inline PlayModes playMode() const
 	{
 		return m_playMode;
@@ -368,13 +380,19 @@ private:
 
 	void removeAllControllers();
 
-	void processAutomations(const TrackList& tracks, MidiTime timeStart, fpp_t frames);
+	// applies automation at the start of a tick (tickOffset 0) and renders
+	// sample-exact automation from given offset until the end of the period
+	void processAutomations(const TrackList& tracks, MidiTime timeStart, f_cnt_t offset, float tickOffset);
+	void renderAutomations(const AutomationPatternMap& patterns, const QSet<const AutomatableModel*>& skip,
+					MidiTime time, float tickOffset, f_cnt_t offset);
 
 	void setModified(bool value);
 
 	void setProjectFileName(QString const & projectFileName);
 
 	AutomationTrack * m_globalAutomationTrack;
+	AutomationCursor m_automationCursor;
+	std::vector<float> m_automationValues;
 
 	IntModel m_tempoModel;
 	MeterModel m_timeSigModel;
@@ -395,6 +413,9 @@ private:
 	volatile bool m_exporting;
 	volatile bool m_exportLoop;
 	volatile bool m_renderBetweenMarkers;
+	bool m_exportRange;
+	MidiTime m_exportRangeBegin;
+	MidiTime m_exportRangeEnd;
 	volatile bool m_playing;
 	volatile bool m_paused;
 
@@ -0,0 +1,107 @@
+/*
+ * StemExporter.h - writes output of single tracks and FX channels to files
+ *                  while the song is rendered once
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef STEM_EXPORTER_H
+#define STEM_EXPORTER_H
+
+#include <atomic>
+#include <vector>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include "lmms_basics.h"
+
+class AudioFileDevice;
+class AudioPort;
+class FxChannel;
+class QThread;
+
+
+class StemExporter
+{
+public:
+	StemExporter();
+	//! Stems which have not been finished yet are discarded
+	~StemExporter();
+
+	//! The exporter takes ownership of the device - stems have to be added
+	//! before start() is called
+	void addStem( AudioPort * port, AudioFileDevice * device );
+	void addStem( FxChannel * channel, AudioFileDevice * device );
+
+	int stemCount() const
+	{
+		return m_stems.size();
+	}
+
+	//! Launch the encoder threads
+	void start();
+
+	//! Called by the mixer once all audio ports and FX channels have been
+	//! processed - queues their output for encoding and blocks while the
+	//! encoders are lagging too far behind
+	void capture();
+
+	//! Wait for all queued periods to be encoded and close all files -
+	//! if discard is set, the files get deleted instead
+	void finish( bool discard = false );
+
+
+private:
+	struct Stem
+	{
+		AudioPort * port;
+		FxChannel * channel;
+		AudioFileDevice * device;
+
+		// periods of output handed from the mixer thread to the encoder
+		// thread owning this stem
+		surroundSampleFrame * ring;
+		std::atomic<int> head;
+		std::atomic<int> tail;
+	} ;
+
+	class EncoderThread;
+
+	void addStem( AudioPort * port, FxChannel * channel, AudioFileDevice * device );
+	void copyOutput( Stem * stem, surroundSampleFrame * dst );
+	// encodes all pending periods of the given stems, returns whether
+	// there were any
+	bool encode( int thread );
+	bool hasPending( int thread ) const;
+
+	std::vector<Stem *> m_stems;
+	std::vector<EncoderThread *> m_threads;
+	int m_numThreads;
+	fpp_t m_framesPerPeriod;
+
+	QMutex m_mutex;
+	QWaitCondition m_dataAvailable;
+	QWaitCondition m_spaceAvailable;
+	bool m_quit;
+
+} ;
+
+
+#endif
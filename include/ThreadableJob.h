@@ -29,6 +29,8 @@
 
 #include <atomic>
 
+#include <QtCore/QString>
+
 class ThreadableJob
 {
 public:
@@ -78,6 +80,10 @@ public:
 
 	virtual bool requiresProcessing() const = 0;
 
+	// used by MixerProfiler to tell jobs apart in traces
+	virtual const char * jobCategory() const = 0;
+	virtual QString jobName() const = 0;
+
 
 protected:
 	virtual void doProcessing() = 0;
@@ -26,6 +26,10 @@
 #ifndef TRACK_H
 #define TRACK_H
 
+#include <atomic>
+#include <vector>
+
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 #include <QtCore/QList>
 #include <QWidget>
@@ -522,6 +526,18 @@ public:
 	// -- for usage by TrackContentObject only ---------------
 	TrackContentObject * addTCO( TrackContentObject * tco );
 	void removeTCO( TrackContentObject * tco );
+	// called whenever a TCO got moved or resized
+	void invalidateTCOIndex()
+	{
+		m_tcoIndexDirty = true;
+		tcosChanged();
+	}
+	// called whenever a TCO changed in any other way that matters for
+	// playback, e.g. which models an automation pattern controls
+	void tcosChanged()
+	{
+		m_tcoRevision = ++s_tcoRevisions;
+	}
 	// -------------------------------------------------------
 	void deleteTCOs();
 
@@ -533,6 +549,12 @@ public:
 	{
 		return m_trackContentObjects;
 	}
+	// changes whenever TCOs got added, removed or changed; unique among
+	// all tracks so it can be used to detect changes of a set of tracks
+	unsigned int tcoRevision() const
+	{
+		return m_tcoRevision;
+	}
 	void getTCOsInRange( tcoVector & tcoV, const MidiTime & start,
 							const MidiTime & end );
 	void swapPositionOfTCOs( int tcoNum1, int tcoNum2 );
@@ -616,6 +638,25 @@ private:
 
 	tcoVector m_trackContentObjects;
 
+	struct TCOIndexEntry
+	{
+		int start;
+		int end;
+		// largest end of this and all preceding entries
+		int maxEnd;
+		TrackContentObject * tco;
+	} ;
+
+	void rebuildTCOIndex();
+
+	// TCOs sorted by start position for getTCOsInRange(), rebuilt on
+	// first use after a TCO got added, removed, moved or resized
+	std::vector<TCOIndexEntry> m_tcoIndex;
+	std::atomic<bool> m_tcoIndexDirty;
+
+	std::atomic<unsigned int> m_tcoRevision;
+	static std::atomic<unsigned int> s_tcoRevisions;
+
 	QMutex m_processingLock;
 
 	friend class TrackView;
@@ -95,6 +95,12 @@ public:
 
 	virtual AutomatedValueMap automatedValuesAt(MidiTime time, int tcoNum = -1) const;
 
+	//! Evaluates given automation and BB TCOs, which have to be sorted by
+	//! position - later TCOs override values of earlier ones. If patterns
+	//! is given, it receives the pattern each value was taken from.
+	static AutomatedValueMap automatedValuesFromTCOs(const Track::tcoVector &tcos, MidiTime time,
+							AutomationPatternMap *patterns = nullptr);
+
 signals:
 	void trackAdded( Track * _track );
 
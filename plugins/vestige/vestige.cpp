@@ -363,6 +363,19 @@ void vestigeInstrument::loadFile( const QString & _file )
 
 
 
+void vestigeInstrument::startRendering()
+{
+	m_pluginMutex.lock();
+	if( m_plugin != NULL )
+	{
+		m_plugin->startProcessing( NULL );
+	}
+	m_pluginMutex.unlock();
+}
+
+
+
+
 void vestigeInstrument::play( sampleFrame * _buf )
 {
 	m_pluginMutex.lock();
@@ -54,6 +54,7 @@ public:
 	vestigeInstrument( InstrumentTrack * _instrument_track );
 	virtual ~vestigeInstrument();
 
+	virtual void startRendering();
 	virtual void play( sampleFrame * _working_buffer );
 
 	virtual void saveSettings( QDomDocument & _doc, QDomElement & _parent );
@@ -323,6 +323,19 @@ QString ZynAddSubFxInstrument::nodeName() const
 
 
 
+void ZynAddSubFxInstrument::startRendering()
+{
+	m_pluginMutex.lock();
+	if( m_remotePlugin != NULL )
+	{
+		m_remotePlugin->startProcessing( NULL );
+	}
+	m_pluginMutex.unlock();
+}
+
+
+
+
 void ZynAddSubFxInstrument::play( sampleFrame * _buf )
 {
 	m_pluginMutex.lock();
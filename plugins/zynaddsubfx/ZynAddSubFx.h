@@ -68,6 +68,7 @@ public:
 	ZynAddSubFxInstrument( InstrumentTrack * _instrument_track );
 	virtual ~ZynAddSubFxInstrument();
 
+	virtual void startRendering();
 	virtual void play( sampleFrame * _working_buffer );
 
 	virtual bool handleMidiEvent( const MidiEvent& event, const MidiTime& time = MidiTime(), f_cnt_t offset = 0 );
@@ -24,6 +24,8 @@
 
 #include "AutomatableModel.h"
 
+#include <algorithm>
+
 #include "lmms_math.h"
 
 #include "AutomationPattern.h"
@@ -32,6 +34,10 @@
 #include "ProjectJournal.h"
 
 long AutomatableModel::s_periodCounter = 0;
+std::atomic<int> AutomatableModel::s_resolvedModels( 0 );
+std::atomic<int> AutomatableModel::s_sampleExactModels( 0 );
+std::atomic<int> AutomatableModel::s_lastResolvedModels( 0 );
+std::atomic<int> AutomatableModel::s_lastSampleExactModels( 0 );
 
 
 
@@ -325,6 +331,51 @@ void AutomatableModel::setAutomatedValue( const float value )
 
 
 
+void AutomatableModel::setAutomatedValues( const float * values, int offset, int frames )
+{
+	++m_setValueDepth;
+
+	m_valueBufferMutex.lock();
+	// controllers take precedence, see valueBuffer()
+	if( !m_controllerConnection || !m_controllerConnection->getController()->isSampleExact() )
+	{
+		offset = qMin( offset, m_valueBuffer.length() );
+		frames = qMin( frames, m_valueBuffer.length() - offset );
+		float * nvalues = m_valueBuffer.values();
+		if( m_lastUpdatedPeriod.load( std::memory_order_relaxed ) != s_periodCounter ||
+			!m_hasSampleExactData )
+		{
+			std::fill( nvalues, nvalues + offset, m_oldValue );
+		}
+		for( int i = 0; i < frames; ++i )
+		{
+			nvalues[offset + i] = fittedValue( scaledValue( values[i] ) );
+		}
+
+		// nothing left to interpolate once automation stops
+		m_oldValue = m_value;
+		m_hasSampleExactData = true;
+		m_lastUpdatedPeriod.store( s_periodCounter, std::memory_order_release );
+	}
+	// unlock first - linked models lock their own buffers
+	m_valueBufferMutex.unlock();
+
+	// notify linked models
+	for( AutoModelVector::Iterator it = m_linkedModels.begin();
+								it != m_linkedModels.end(); ++it )
+	{
+		if( (*it)->m_setValueDepth < 1 )
+		{
+			(*it)->setAutomatedValues( values, offset, frames );
+		}
+	}
+
+	--m_setValueDepth;
+}
+
+
+
+
 void AutomatableModel::setRange( const float min, const float max,
 							const float step )
 {
@@ -503,15 +554,40 @@ float AutomatableModel::controllerValue( int frameOffset ) const
 
 ValueBuffer * AutomatableModel::valueBuffer()
 {
-	QMutexLocker m( &m_valueBufferMutex );
-	// if we've already calculated the valuebuffer this period, return the cached buffer
-	if( m_lastUpdatedPeriod == s_periodCounter )
+	// if we've already calculated the valuebuffer this period, return the
+	// cached buffer - the acquire pairs with publishing it below, so the
+	// read path doesn't need the mutex
+	if( m_lastUpdatedPeriod.load( std::memory_order_acquire ) == s_periodCounter )
 	{
 		return m_hasSampleExactData
 			? &m_valueBuffer
 			: NULL;
 	}
 
+	QMutexLocker m( &m_valueBufferMutex );
+	// another thread may have calculated it while we were waiting
+	if( m_lastUpdatedPeriod.load( std::memory_order_relaxed ) != s_periodCounter )
+	{
+		m_hasSampleExactData = updateValueBuffer();
+		m_lastUpdatedPeriod.store( s_periodCounter, std::memory_order_release );
+
+		s_resolvedModels.fetch_add( 1, std::memory_order_relaxed );
+		if( m_hasSampleExactData )
+		{
+			s_sampleExactModels.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+
+	return m_hasSampleExactData
+		? &m_valueBuffer
+		: NULL;
+}
+
+
+
+
+bool AutomatableModel::updateValueBuffer()
+{
 	float val = m_value; // make sure our m_value doesn't change midway
 
 	ValueBuffer * vb;
@@ -541,9 +617,7 @@ ValueBuffer * AutomatableModel::valueBuffer()
 					"lacks implementation for a scale type");
 				break;
 			}
-			m_lastUpdatedPeriod = s_periodCounter;
-			m_hasSampleExactData = true;
-			return &m_valueBuffer;
+			return true;
 		}
 	}
 	AutomatableModel* lm = NULL;
@@ -560,25 +634,40 @@ ValueBuffer * AutomatableModel::valueBuffer()
 		{
 			nvalues[i] = fittedValue( values[i] );
 		}
-		m_lastUpdatedPeriod = s_periodCounter;
-		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return true;
 	}
 
 	if( m_oldValue != val )
 	{
 		m_valueBuffer.interpolate( m_oldValue, val );
 		m_oldValue = val;
-		m_lastUpdatedPeriod = s_periodCounter;
-		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return true;
 	}
 
 	// if we have no sample-exact source for a ValueBuffer, return NULL to signify that no data is available at the moment
 	// in which case the recipient knows to use the static value() instead
-	m_lastUpdatedPeriod = s_periodCounter;
-	m_hasSampleExactData = false;
-	return NULL;
+	return false;
+}
+
+
+
+
+void AutomatableModel::incrementPeriodCounter()
+{
+	s_lastResolvedModels = s_resolvedModels.exchange( 0 );
+	s_lastSampleExactModels = s_sampleExactModels.exchange( 0 );
+	++s_periodCounter;
+}
+
+
+
+
+AutomatableModel::Statistics AutomatableModel::lastPeriodStatistics()
+{
+	Statistics stats;
+	stats.resolved = s_lastResolvedModels;
+	stats.sampleExact = s_lastSampleExactModels;
+	return stats;
 }
 
 
@@ -0,0 +1,233 @@
+/*
+ * AutomationCursor.cpp - incremental evaluation of song automation
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AutomationCursor.h"
+
+#include <algorithm>
+
+#include <QtCore/QSet>
+
+#include "AutomationPattern.h"
+#include "BBTrack.h"
+
+
+static bool hasAutomation( const TrackContentObject * tco )
+{
+	const AutomationPattern * p = dynamic_cast<const AutomationPattern *>( tco );
+	return p == NULL || p->hasAutomation();
+}
+
+
+
+
+AutomationCursor::AutomationCursor() :
+	m_valid( false ),
+	m_time( 0 ),
+	m_trackStates(),
+	m_tcos(),
+	m_tcoStates()
+{
+}
+
+
+
+
+void AutomationCursor::reset()
+{
+	m_valid = false;
+	m_time = 0;
+	m_trackStates.clear();
+	m_tcos.clear();
+	m_tcoStates.clear();
+}
+
+
+
+
+AutomatedValueMap AutomationCursor::valuesAt( const TrackContainer::TrackList & tracks, MidiTime time,
+							AutomationPatternMap * patterns )
+{
+	if( !isUpToDate( tracks, time ) )
+	{
+		reset();
+		// take the snapshot first so that changes done while
+		// collecting are noticed next time
+		for( Track * track : tracks )
+		{
+			const TrackState state = { track, track->isMuted(), track->tcoRevision() };
+			m_trackStates.push_back( state );
+		}
+		collect( tracks, 0, time );
+		m_valid = true;
+	}
+	else if( time > m_time )
+	{
+		collect( tracks, m_time + 1, time );
+	}
+	m_time = time;
+
+	return TrackContainer::automatedValuesFromTCOs( m_tcos, time, patterns );
+}
+
+
+
+
+bool AutomationCursor::isUpToDate( const TrackContainer::TrackList & tracks, MidiTime time ) const
+{
+	if( !m_valid || time < m_time ||
+		(size_t) tracks.size() != m_trackStates.size() )
+	{
+		return false;
+	}
+
+	for( int i = 0; i < tracks.size(); ++i )
+	{
+		const TrackState & state = m_trackStates[i];
+		if( tracks[i] != state.track ||
+			tracks[i]->isMuted() != state.muted ||
+			tracks[i]->tcoRevision() != state.revision )
+		{
+			return false;
+		}
+	}
+
+	for( int i = 0; i < m_tcos.size(); ++i )
+	{
+		if( m_tcos[i]->isMuted() != m_tcoStates[i].muted ||
+			hasAutomation( m_tcos[i] ) != m_tcoStates[i].hasAutomation )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+
+/*! \brief Add all TCOs starting within the given range
+ *
+ *  All TCOs collected so far start before the range, so the new ones can
+ *  just be appended without breaking the order.
+ */
+void AutomationCursor::collect( const TrackContainer::TrackList & tracks, MidiTime from, MidiTime to )
+{
+	Track::tcoVector started;
+
+	for( Track * track : tracks )
+	{
+		if( track->isMuted() )
+		{
+			continue;
+		}
+
+		switch( track->type() )
+		{
+			case Track::AutomationTrack:
+			case Track::HiddenAutomationTrack:
+			case Track::BBTrack:
+				track->getTCOsInRange( started, from, to );
+				break;
+			default:
+				break;
+		}
+	}
+
+	// TCOs which already were playing at the beginning of the range have
+	// been collected (or dropped) before
+	int first = 0;
+	while( first < started.size() && started[first]->startPosition() < from )
+	{
+		++first;
+	}
+	if( first == started.size() )
+	{
+		return;
+	}
+
+	m_tcos += started.mid( first );
+	prune();
+}
+
+
+
+
+/*! \brief Drop all TCOs whose values are overridden by later TCOs anyway
+ *
+ *  A pattern is overridden if all its models are controlled by later
+ *  patterns, a BB TCO if there is a later BB TCO of the same BB track.
+ *  Muted TCOs and patterns without values do not override anything, but
+ *  are kept so that changing them is noticed.
+ */
+void AutomationCursor::prune()
+{
+	QSet<const AutomatableModel *> models;
+	QSet<int> bbIndexes;
+	Track::tcoVector kept;
+
+	for( int i = m_tcos.size() - 1; i >= 0; --i )
+	{
+		TrackContentObject * tco = m_tcos[i];
+		if( tco->isMuted() || !hasAutomation( tco ) )
+		{
+			kept.push_back( tco );
+		}
+		else if( AutomationPattern * p = dynamic_cast<AutomationPattern *>( tco ) )
+		{
+			bool overridden = true;
+			for( const QPointer<AutomatableModel> & object : p->objects() )
+			{
+				const AutomatableModel * model = object;
+				if( model && !models.contains( model ) )
+				{
+					models.insert( model );
+					overridden = false;
+				}
+			}
+			if( !overridden )
+			{
+				kept.push_back( tco );
+			}
+		}
+		else if( BBTCO * bb = dynamic_cast<BBTCO *>( tco ) )
+		{
+			const int bbIndex = static_cast<BBTrack *>( bb->getTrack() )->index();
+			if( !bbIndexes.contains( bbIndex ) )
+			{
+				bbIndexes.insert( bbIndex );
+				kept.push_back( tco );
+			}
+		}
+		// anything else never determines a value
+	}
+
+	std::reverse( kept.begin(), kept.end() );
+	m_tcos = kept;
+
+	m_tcoStates.clear();
+	for( TrackContentObject * tco : m_tcos )
+	{
+		const TCOState state = { tco->isMuted(), hasAutomation( tco ) };
+		m_tcoStates.push_back( state );
+	}
+}
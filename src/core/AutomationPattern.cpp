@@ -33,6 +33,7 @@
 #include "BBTrackContainer.h"
 #include "Song.h"
 
+#include <algorithm>
 #include <cmath>
 
 int AutomationPattern::s_quantization = 1;
@@ -47,6 +48,7 @@ AutomationPattern::AutomationPattern( AutomationTrack * _auto_track ) :
 	m_tension( 1.0 ),
 	m_progressionType( DiscreteProgression ),
 	m_dragging( false ),
+	m_lookupHint( -1 ),
 	m_isRecording( false ),
 	m_lastRecordedValue( 0 )
 {
@@ -75,15 +77,11 @@ AutomationPattern::AutomationPattern( const AutomationPattern & _pat_to_copy ) :
 	TrackContentObject( _pat_to_copy.m_autoTrack ),
 	m_autoTrack( _pat_to_copy.m_autoTrack ),
 	m_objects( _pat_to_copy.m_objects ),
+	m_timeMap( _pat_to_copy.m_timeMap ),
 	m_tension( _pat_to_copy.m_tension ),
-	m_progressionType( _pat_to_copy.m_progressionType )
+	m_progressionType( _pat_to_copy.m_progressionType ),
+	m_lookupHint( -1 )
 {
-	for( timeMap::const_iterator it = _pat_to_copy.m_timeMap.begin();
-				it != _pat_to_copy.m_timeMap.end(); ++it )
-	{
-		m_timeMap[it.key()] = it.value();
-		m_tangents[it.key()] = _pat_to_copy.m_tangents[it.key()];
-	}
 	switch( getTrack()->trackContainer()->type() )
 	{
 		case TrackContainer::BBContainer:
@@ -118,6 +116,11 @@ bool AutomationPattern::addObject( AutomatableModel * _obj, bool _search_dup )
 			this, SLOT( objectDestroyed( jo_id_t ) ),
 						Qt::DirectConnection );
 
+	if( getTrack() )
+	{
+		getTrack()->tcosChanged();
+	}
+
 	emit dataChanged();
 
 	return true;
@@ -205,7 +208,7 @@ MidiTime AutomationPattern::putValue( const MidiTime & time,
 				time;
 
 	m_timeMap[ newTime ] = value;
-	timeMap::const_iterator it = m_timeMap.find( newTime );
+	timeMap::iterator it = m_timeMap.find( newTime );
 
 	// Remove control points that are covered by the new points
 	// quantization value. Control Key to override
@@ -242,8 +245,7 @@ void AutomationPattern::removeValue( const MidiTime & time )
 	cleanObjects();
 
 	m_timeMap.remove( time );
-	m_tangents.remove( time );
-	timeMap::const_iterator it = m_timeMap.lowerBound( time );
+	timeMap::iterator it = m_timeMap.lowerBound( time );
 	if( it != m_timeMap.begin() )
 	{
 		--it;
@@ -303,10 +305,7 @@ MidiTime AutomationPattern::setDragValue( const MidiTime & time,
 	//Restore to the state before it the point were being dragged
 	m_timeMap = m_oldTimeMap;
 
-	for( timeMap::const_iterator it = m_timeMap.begin(); it != m_timeMap.end(); ++it )
-	{
-		generateTangents( it, 3 );
-	}
+	generateTangents();
 
 	return this->putValue( time, value, quantPos, controlKey );
 
@@ -333,25 +332,22 @@ float AutomationPattern::valueAt( const MidiTime & _time ) const
 		return 0;
 	}
 
-	if( m_timeMap.contains( _time ) )
-	{
-		return m_timeMap[_time];
-	}
-
-	// lowerBound returns next value with greater key, therefore we take
-	// the previous element to get the current value
-	timeMap::ConstIterator v = m_timeMap.lowerBound( _time );
-
-	if( v == m_timeMap.begin() )
+	// last point at or before _time
+	const int i = m_timeMap.lastIndexAt( _time,
+				m_lookupHint.load( std::memory_order_relaxed ) );
+	if( i < 0 )
 	{
 		return 0;
 	}
-	if( v == m_timeMap.end() )
+	m_lookupHint.store( i, std::memory_order_relaxed );
+
+	timeMap::ConstIterator v = m_timeMap.constBegin() + i;
+	if( v.key() == _time || v + 1 == m_timeMap.end() )
 	{
-		return (v-1).value();
+		return v.value();
 	}
 
-	return valueAt( v-1, _time - (v-1).key() );
+	return valueAt( v, _time - v.key() );
 }
 
 
@@ -381,8 +377,8 @@ float AutomationPattern::valueAt( timeMap::const_iterator v, int offset ) const
 		// tangents _m1 and _m2
 		int numValues = ((v+1).key() - v.key());
 		float t = (float) offset / (float) numValues;
-		float m1 = (m_tangents[v.key()]) * numValues * m_tension;
-		float m2 = (m_tangents[(v+1).key()]) * numValues * m_tension;
+		float m1 = v.tangent() * numValues * m_tension;
+		float m2 = (v+1).tangent() * numValues * m_tension;
 
 		return ( 2*pow(t,3) - 3*pow(t,2) + 1 ) * v.value()
 				+ ( pow(t,3) - 2*pow(t,2) + t) * m1
@@ -394,6 +390,91 @@ float AutomationPattern::valueAt( timeMap::const_iterator v, int offset ) const
 
 
 
+/*! \brief Render the curve at fractional positions
+ *
+ *  Gives the same values as valueAt() at integer positions. The lookup is
+ *  only done once, then the points are walked along while rendering and each
+ *  segment is rendered in one go.
+ */
+void AutomationPattern::valuesAt( float tick, float ticksPerFrame, float lastTick,
+						float * values, int frames ) const
+{
+	if( m_timeMap.isEmpty() )
+	{
+		std::fill( values, values + frames, 0.0f );
+		return;
+	}
+
+	// first point behind the current position
+	timeMap::ConstIterator next = m_timeMap.upperBound(
+				(int) floorf( qMin( tick, lastTick ) ) );
+
+	int i = 0;
+	while( i < frames )
+	{
+		const float pos = qMin( tick + i * ticksPerFrame, lastTick );
+		while( next != m_timeMap.end() && next.key() <= pos )
+		{
+			++next;
+		}
+
+		// frames until the next point is reached
+		int end = frames;
+		if( next != m_timeMap.end() && next.key() <= lastTick &&
+							ticksPerFrame > 0 )
+		{
+			const float reached = ceilf( ( next.key() - tick ) / ticksPerFrame );
+			if( reached < end )
+			{
+				end = qMax( i + 1, (int) reached );
+			}
+		}
+
+		if( next == m_timeMap.begin() || next == m_timeMap.end() ||
+			m_progressionType == DiscreteProgression )
+		{
+			const float value = next == m_timeMap.begin() ?
+						0.0f : ( next - 1 ).value();
+			std::fill( values + i, values + end, value );
+		}
+		else if( m_progressionType == LinearProgression )
+		{
+			timeMap::ConstIterator v = next - 1;
+			const float start = v.key();
+			const float slope = ( next.value() - v.value() ) /
+							( next.key() - v.key() );
+			for( ; i < end; ++i )
+			{
+				const float offset = qMin( tick + i * ticksPerFrame, lastTick ) - start;
+				values[i] = v.value() + offset * slope;
+			}
+		}
+		else /* CubicHermiteProgression */
+		{
+			// see valueAt( timeMap::const_iterator, int )
+			timeMap::ConstIterator v = next - 1;
+			const float start = v.key();
+			const float numValues = next.key() - v.key();
+			const float m1 = v.tangent() * numValues * m_tension;
+			const float m2 = next.tangent() * numValues * m_tension;
+			for( ; i < end; ++i )
+			{
+				const float t = ( qMin( tick + i * ticksPerFrame, lastTick ) - start ) / numValues;
+				const float t2 = t * t;
+				const float t3 = t2 * t;
+				values[i] = ( 2 * t3 - 3 * t2 + 1 ) * v.value()
+						+ ( t3 - 2 * t2 + t ) * m1
+						+ ( -2 * t3 + 3 * t2 ) * next.value()
+						+ ( t3 - t2 ) * m2;
+			}
+		}
+		i = end;
+	}
+}
+
+
+
+
 float *AutomationPattern::valuesAfter( const MidiTime & _time ) const
 {
 	timeMap::ConstIterator v = m_timeMap.lowerBound( _time );
@@ -786,7 +867,6 @@ void AutomationPattern::resolveAllIDs()
 void AutomationPattern::clear()
 {
 	m_timeMap.clear();
-	m_tangents.clear();
 
 	emit dataChanged();
 }
@@ -814,6 +894,11 @@ void AutomationPattern::objectDestroyed( jo_id_t _id )
 		}
 	}
 
+	if( getTrack() )
+	{
+		getTrack()->tcosChanged();
+	}
+
 	emit dataChanged();
 }
 
@@ -846,12 +931,17 @@ void AutomationPattern::generateTangents()
 
 
 
-void AutomationPattern::generateTangents( timeMap::const_iterator it,
+void AutomationPattern::generateTangents( timeMap::iterator it,
 							int numToGenerate )
 {
+	if( it == m_timeMap.end() )
+	{
+		return;
+	}
+
 	if( m_timeMap.size() < 2 && numToGenerate > 0 )
 	{
-		m_tangents[it.key()] = 0;
+		it.tangent() = 0;
 		return;
 	}
 
@@ -859,18 +949,18 @@ void AutomationPattern::generateTangents( timeMap::const_iterator it,
 	{
 		if( it == m_timeMap.begin() )
 		{
-			m_tangents[it.key()] =
+			it.tangent() =
 					( (it+1).value() - (it).value() ) /
 						( (it+1).key() - (it).key() );
 		}
 		else if( it+1 == m_timeMap.end() )
 		{
-			m_tangents[it.key()] = 0;
+			it.tangent() = 0;
 			return;
 		}
 		else
 		{
-			m_tangents[it.key()] =
+			it.tangent() =
 					( (it+1).value() - (it-1).value() ) /
 						( (it+1).key() - (it-1).key() );
 		}
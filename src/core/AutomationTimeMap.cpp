@@ -0,0 +1,169 @@
+/*
+ * AutomationTimeMap.cpp - flat sorted storage of automation points
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AutomationTimeMap.h"
+
+#include <algorithm>
+
+
+void AutomationTimeMap::clear()
+{
+	m_ticks.clear();
+	m_values.clear();
+	m_tangents.clear();
+}
+
+
+
+
+float & AutomationTimeMap::operator[]( int tick )
+{
+	const int i = lowerBoundIndex( tick );
+	if( i == size() || m_ticks[i] != tick )
+	{
+		m_ticks.insert( m_ticks.begin() + i, tick );
+		m_values.insert( m_values.begin() + i, 0.0f );
+		m_tangents.insert( m_tangents.begin() + i, 0.0f );
+	}
+	return m_values[i];
+}
+
+
+
+
+float AutomationTimeMap::value( int tick, float defaultValue ) const
+{
+	const int i = findIndex( tick );
+	return i != size() ? m_values[i] : defaultValue;
+}
+
+
+
+
+AutomationTimeMap::iterator AutomationTimeMap::insert( int tick, float value )
+{
+	( *this )[tick] = value;
+	return find( tick );
+}
+
+
+
+
+int AutomationTimeMap::remove( int tick )
+{
+	const int i = findIndex( tick );
+	if( i == size() )
+	{
+		return 0;
+	}
+	erase( iterator( this, i ) );
+	return 1;
+}
+
+
+
+
+AutomationTimeMap::iterator AutomationTimeMap::erase( iterator it )
+{
+	const int i = it.index();
+	m_ticks.erase( m_ticks.begin() + i );
+	m_values.erase( m_values.begin() + i );
+	m_tangents.erase( m_tangents.begin() + i );
+	return iterator( this, i );
+}
+
+
+
+
+QList<int> AutomationTimeMap::keys() const
+{
+	QList<int> k;
+	k.reserve( size() );
+	for( int tick : m_ticks )
+	{
+		k << tick;
+	}
+	return k;
+}
+
+
+
+
+QList<float> AutomationTimeMap::values() const
+{
+	QList<float> v;
+	v.reserve( size() );
+	for( float value : m_values )
+	{
+		v << value;
+	}
+	return v;
+}
+
+
+
+
+int AutomationTimeMap::lastIndexAt( float tick, int hint ) const
+{
+	const int n = size();
+	if( hint >= 0 && hint < n && m_ticks[hint] <= tick )
+	{
+		// playback and drawing mostly move on by less than a point
+		for( int i = hint; i < hint + 4; ++i )
+		{
+			if( i + 1 == n || m_ticks[i + 1] > tick )
+			{
+				return i;
+			}
+		}
+	}
+
+	return static_cast<int>( std::upper_bound( m_ticks.begin(), m_ticks.end(), tick ) -
+								m_ticks.begin() ) - 1;
+}
+
+
+
+
+int AutomationTimeMap::lowerBoundIndex( int tick ) const
+{
+	return static_cast<int>( std::lower_bound( m_ticks.begin(), m_ticks.end(), tick ) -
+								m_ticks.begin() );
+}
+
+
+
+
+int AutomationTimeMap::upperBoundIndex( int tick ) const
+{
+	return static_cast<int>( std::upper_bound( m_ticks.begin(), m_ticks.end(), tick ) -
+								m_ticks.begin() );
+}
+
+
+
+
+int AutomationTimeMap::findIndex( int tick ) const
+{
+	const int i = lowerBoundIndex( tick );
+	return i != size() && m_ticks[i] == tick ? i : size();
+}
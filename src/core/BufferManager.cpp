@@ -26,21 +26,276 @@
 
 #include "BufferManager.h"
 
-#include "Engine.h"
-#include "Mixer.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
 #include "MemoryManager.h"
 
-static fpp_t framesPerPeriod;
+
+namespace
+{
+
+const size_t CacheLineSize = 64;
+
+// buffers allocated in advance by init()
+const int PreallocatedBuffers = 128;
+// upper limit for the pool - buffers beyond are allocated and freed directly
+const uint32_t MaxBuffers = 4096;
+const int ThreadCacheSize = 16;
+
+const uint32_t NoBuffer = 0xffffffff;
+
+
+// sits in its own cache line right in front of each buffer
+struct alignas( CacheLineSize ) BufferHeader
+{
+	void * memory;
+	std::atomic<uint32_t> next;
+	uint32_t index;
+	uint32_t generation;
+} ;
+
+static_assert( sizeof( BufferHeader ) == CacheLineSize,
+				"buffers have to start at a cache line" );
+
+
+struct ThreadCache
+{
+	BufferHeader * buffers[ThreadCacheSize];
+	int count;
+} ;
+
+
+fpp_t s_framesPerPeriod = 0;
+std::atomic<uint32_t> s_generation( 0 );
+
+// pooled buffers by index - slots of freed buffers get reused
+BufferHeader * s_buffers[MaxBuffers];
+std::atomic<uint32_t> s_bufferCount( 0 );
+
+// unused slots below s_bufferCount, same layout as s_freeList
+std::atomic<uint64_t> s_freeSlots( NoBuffer );
+std::atomic<uint32_t> s_nextFreeSlot[MaxBuffers];
+
+// head of free list: ABA tag in upper, buffer index in lower 32 bits
+std::atomic<uint64_t> s_freeList( NoBuffer );
+
+thread_local ThreadCache s_threadCache;
+
+std::atomic<int> s_pooled( 0 );
+std::atomic<int> s_inUse( 0 );
+std::atomic<int> s_highWaterMark( 0 );
+std::atomic<int> s_allocations( 0 );
+
+
+
+inline BufferHeader * headerOf( sampleFrame * buf )
+{
+	return reinterpret_cast<BufferHeader *>( buf ) - 1;
+}
+
+
+inline sampleFrame * bufferOf( BufferHeader * header )
+{
+	return reinterpret_cast<sampleFrame *>( header + 1 );
+}
+
+
+void pushFreeSlot( uint32_t index )
+{
+	uint64_t head = s_freeSlots.load( std::memory_order_relaxed );
+	uint64_t newHead;
+	do
+	{
+		s_nextFreeSlot[index].store( static_cast<uint32_t>( head ), std::memory_order_relaxed );
+		newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | index;
+	}
+	while( !s_freeSlots.compare_exchange_weak( head, newHead,
+					std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+
+uint32_t popFreeSlot()
+{
+	uint64_t head = s_freeSlots.load( std::memory_order_acquire );
+	while( static_cast<uint32_t>( head ) != NoBuffer )
+	{
+		const uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) |
+				s_nextFreeSlot[static_cast<uint32_t>( head )].load( std::memory_order_relaxed );
+		if( s_freeSlots.compare_exchange_weak( head, newHead,
+					std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			return static_cast<uint32_t>( head );
+		}
+	}
+	return NoBuffer;
+}
+
+
+BufferHeader * allocateBuffer()
+{
+	const size_t size = sizeof( BufferHeader ) + s_framesPerPeriod * sizeof( sampleFrame );
+	void * memory = MemoryManager::alloc( size + CacheLineSize - 1 );
+	const uintptr_t aligned = ( reinterpret_cast<uintptr_t>( memory ) + CacheLineSize - 1 ) &
+							~uintptr_t( CacheLineSize - 1 );
+
+	BufferHeader * header = new( reinterpret_cast<void *>( aligned ) ) BufferHeader;
+	header->memory = memory;
+	header->next = NoBuffer;
+	header->generation = s_generation.load( std::memory_order_relaxed );
+
+	uint32_t index = popFreeSlot();
+	if( index == NoBuffer )
+	{
+		index = s_bufferCount.load( std::memory_order_relaxed );
+		while( index < MaxBuffers &&
+			!s_bufferCount.compare_exchange_weak( index, index + 1, std::memory_order_relaxed ) )
+		{
+		}
+	}
+	if( index < MaxBuffers )
+	{
+		s_buffers[index] = header;
+		header->index = index;
+		++s_pooled;
+	}
+	else
+	{
+		header->index = NoBuffer;
+	}
+
+	return header;
+}
+
+
+void freeBuffer( BufferHeader * header )
+{
+	if( header->index != NoBuffer )
+	{
+		s_buffers[header->index] = nullptr;
+		pushFreeSlot( header->index );
+		--s_pooled;
+	}
+	void * memory = header->memory;
+	header->~BufferHeader();
+	MemoryManager::free( memory );
+}
+
+
+void pushFreeList( BufferHeader * header )
+{
+	uint64_t head = s_freeList.load( std::memory_order_relaxed );
+	uint64_t newHead;
+	do
+	{
+		header->next.store( static_cast<uint32_t>( head ), std::memory_order_relaxed );
+		newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | header->index;
+	}
+	while( !s_freeList.compare_exchange_weak( head, newHead,
+					std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+
+BufferHeader * popFreeList()
+{
+	uint64_t head = s_freeList.load( std::memory_order_acquire );
+	while( static_cast<uint32_t>( head ) != NoBuffer )
+	{
+		BufferHeader * header = s_buffers[static_cast<uint32_t>( head )];
+		const uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) |
+						header->next.load( std::memory_order_relaxed );
+		if( s_freeList.compare_exchange_weak( head, newHead,
+					std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			return header;
+		}
+	}
+	return nullptr;
+}
+
+
+bool isStale( BufferHeader * header )
+{
+	return header->generation != s_generation.load( std::memory_order_relaxed );
+}
+
+}
+
+
+
 
 void BufferManager::init( fpp_t framesPerPeriod )
 {
-	::framesPerPeriod = framesPerPeriod;
+	// buffers of the previous size are dropped - the ones which are still
+	// in use will be freed in release()
+	while( BufferHeader * header = popFreeList() )
+	{
+		freeBuffer( header );
+	}
+	++s_generation;
+	s_framesPerPeriod = framesPerPeriod;
+
+	s_highWaterMark = s_inUse.load();
+	s_allocations = 0;
+
+	for( int i = 0; i < PreallocatedBuffers; ++i )
+	{
+		BufferHeader * header = allocateBuffer();
+		if( header->index == NoBuffer )
+		{
+			freeBuffer( header );
+			break;
+		}
+		pushFreeList( header );
+	}
 }
 
 
 sampleFrame * BufferManager::acquire()
 {
-	return MM_ALLOC( sampleFrame, ::framesPerPeriod );
+	ThreadCache & cache = s_threadCache;
+
+	if( cache.count == 0 )
+	{
+		// take a batch so we don't hit the shared free list every time
+		while( cache.count < ThreadCacheSize / 2 )
+		{
+			BufferHeader * header = popFreeList();
+			if( header == nullptr )
+			{
+				break;
+			}
+			cache.buffers[cache.count++] = header;
+		}
+	}
+
+	BufferHeader * header = nullptr;
+	while( header == nullptr && cache.count > 0 )
+	{
+		header = cache.buffers[--cache.count];
+		if( isStale( header ) )
+		{
+			freeBuffer( header );
+			header = nullptr;
+		}
+	}
+
+	if( header == nullptr )
+	{
+		header = allocateBuffer();
+		++s_allocations;
+	}
+
+	const int inUse = ++s_inUse;
+	int highWaterMark = s_highWaterMark.load( std::memory_order_relaxed );
+	while( inUse > highWaterMark &&
+		!s_highWaterMark.compare_exchange_weak( highWaterMark, inUse, std::memory_order_relaxed ) )
+	{
+	}
+
+	return bufferOf( header );
 }
 
 void BufferManager::clear( sampleFrame *ab, const f_cnt_t frames, const f_cnt_t offset )
@@ -59,6 +314,65 @@ void BufferManager::clear( surroundSampleFrame * ab, const f_cnt_t frames,
 
 void BufferManager::release( sampleFrame * buf )
 {
-	MM_FREE( buf );
+	if( buf == nullptr )
+	{
+		return;
+	}
+
+	--s_inUse;
+
+	BufferHeader * header = headerOf( buf );
+	if( header->index == NoBuffer || isStale( header ) )
+	{
+		freeBuffer( header );
+		return;
+	}
+
+	ThreadCache & cache = s_threadCache;
+	if( cache.count == ThreadCacheSize )
+	{
+		// hand half of our buffers back to other threads
+		while( cache.count > ThreadCacheSize / 2 )
+		{
+			BufferHeader * cached = cache.buffers[--cache.count];
+			if( isStale( cached ) )
+			{
+				freeBuffer( cached );
+			}
+			else
+			{
+				pushFreeList( cached );
+			}
+		}
+	}
+	cache.buffers[cache.count++] = header;
+}
+
+
+void BufferManager::releaseThreadCache()
+{
+	ThreadCache & cache = s_threadCache;
+	while( cache.count > 0 )
+	{
+		BufferHeader * cached = cache.buffers[--cache.count];
+		if( isStale( cached ) )
+		{
+			freeBuffer( cached );
+		}
+		else
+		{
+			pushFreeList( cached );
+		}
+	}
 }
 
+
+BufferManager::Statistics BufferManager::statistics()
+{
+	Statistics stats;
+	stats.buffers = s_pooled;
+	stats.inUse = s_inUse;
+	stats.highWaterMark = s_highWaterMark;
+	stats.allocations = s_allocations;
+	return stats;
+}
@@ -24,13 +24,17 @@
  *
  */
 
+#include <algorithm>
+
 #include <QDomElement>
 #include <QObject>
 #include <QVector>
 
 
 #include "Song.h"
+#include "AutomatableModel.h"
 #include "Mixer.h"
+#include "MixerWorkerThread.h"
 #include "ControllerConnection.h"
 #include "ControllerDialog.h"
 #include "LfoController.h"
@@ -40,6 +44,8 @@
 
 long Controller::s_periods = 0;
 QVector<Controller *> Controller::s_controllers;
+std::vector<Controller *> Controller::s_queuedControllers;
+long Controller::s_queueRounds = 0;
 
 
 
@@ -50,7 +56,10 @@ Controller::Controller( ControllerTypes _type, Model * _parent,
 	m_valueBuffer( Engine::mixer()->framesPerPeriod() ),
 	m_bufferLastUpdated( -1 ),
 	m_connectionCount( 0 ),
-	m_type( _type )
+	m_type( _type ),
+	m_dependencies( 0 ),
+	m_dependenciesMet( 0 ),
+	m_queuedRound( -1 )
 {
 	if( _type != DummyController && _type != MidiController )
 	{
@@ -137,6 +146,94 @@ void Controller::updateValueBuffer()
 }
 
 
+void Controller::queueControllers()
+{
+	++s_queueRounds;
+	s_queuedControllers.clear();
+
+	// controllers nothing is connected to aren't read during the period
+	for( ControllerConnection * connection : ControllerConnection::connections() )
+	{
+		Controller * c = connection->getController();
+		if( c->type() != DummyController && c->m_queuedRound != s_queueRounds )
+		{
+			c->m_queuedRound = s_queueRounds;
+			c->m_dependents.clear();
+			c->m_dependencies = 0;
+			c->m_dependenciesMet = 0;
+			s_queuedControllers.push_back( c );
+		}
+	}
+
+	for( Controller * c : s_queuedControllers )
+	{
+		c->addDependencies();
+	}
+
+	// controllers depending on each other in a cycle never get queued and
+	// keep being updated whenever they are read first
+	for( Controller * c : s_queuedControllers )
+	{
+		if( c->m_dependencies == 0 )
+		{
+			MixerWorkerThread::addJob( c );
+		}
+	}
+}
+
+
+
+
+void Controller::dependsOn( const AutomatableModel * model )
+{
+	ControllerConnection * connection = model->controllerConnection();
+	if( connection == NULL )
+	{
+		return;
+	}
+
+	Controller * input = connection->getController();
+	if( input == this || input->m_queuedRound != s_queueRounds ||
+		std::find( input->m_dependents.begin(), input->m_dependents.end(),
+						this ) != input->m_dependents.end() )
+	{
+		return;
+	}
+
+	input->m_dependents.push_back( this );
+	++m_dependencies;
+}
+
+
+
+
+void Controller::doProcessing()
+{
+	if( m_bufferLastUpdated != s_periods )
+	{
+		updateValueBuffer();
+	}
+
+	for( Controller * c : m_dependents )
+	{
+		c->dependencyDone();
+	}
+}
+
+
+
+
+void Controller::dependencyDone()
+{
+	if( ++m_dependenciesMet == m_dependencies )
+	{
+		MixerWorkerThread::addJob( this );
+	}
+}
+
+
+
+
 // Get position in frames
 unsigned int Controller::runningFrames()
 {
@@ -28,6 +28,8 @@
 #include <QObject>
 
 
+#include "Engine.h"
+#include "Mixer.h"
 #include "Song.h"
 #include "ControllerConnection.h"
 
@@ -35,6 +37,27 @@
 ControllerConnectionVector ControllerConnection::s_connections;
 
 
+// the mixer walks s_connections every period to queue the controllers, see
+// Controller::queueControllers() - the mixer is gone already when the last
+// models get destroyed on shutdown
+static void lockConnections()
+{
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->requestChangeInModel();
+	}
+}
+
+
+static void unlockConnections()
+{
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->doneChangeInModel();
+	}
+}
+
+
 
 ControllerConnection::ControllerConnection( Controller * _controller ) :
 	m_controller( NULL ),
@@ -50,7 +73,9 @@ ControllerConnection::ControllerConnection( Controller * _controller ) :
 		m_controller = Controller::create( Controller::DummyController,
 									NULL );
 	}
+	lockConnections();
 	s_connections.append( this );
+	unlockConnections();
 }
 
 
@@ -61,7 +86,9 @@ ControllerConnection::ControllerConnection( int _controllerId ) :
 	m_controllerId( _controllerId ),
 	m_ownsController( false )
 {
+	lockConnections();
 	s_connections.append( this );
+	unlockConnections();
 }
 
 
@@ -69,6 +96,7 @@ ControllerConnection::ControllerConnection( int _controllerId ) :
 
 ControllerConnection::~ControllerConnection()
 {
+	lockConnections();
 	if( m_controller && m_controller->type() != Controller::DummyController )
 	{
 		m_controller->removeConnection( this );
@@ -78,6 +106,7 @@ ControllerConnection::~ControllerConnection()
 	{
 		delete m_controller;
 	}
+	unlockConnections();
 }
 
 
@@ -29,6 +29,8 @@
 #include "EffectChain.h"
 #include "Effect.h"
 #include "DummyEffect.h"
+#include "Engine.h"
+#include "Mixer.h"
 #include "MixHelpers.h"
 #include "Song.h"
 
@@ -191,13 +193,20 @@ bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, b
 
 	MixHelpers::sanitize( _buf, _frames );
 
+	MixerProfiler & profiler = Engine::mixer()->profiler();
+
 	bool moreEffects = false;
 	for( EffectList::Iterator it = m_effects.begin(); it != m_effects.end(); ++it )
 	{
 		if( hasInputNoise || ( *it )->isRunning() )
 		{
+			const int64_t start = profiler.isTracing() ? profiler.timestamp() : 0;
 			moreEffects |= ( *it )->processAudioBuffer( _buf, _frames );
 			MixHelpers::sanitize( _buf, _frames );
+			if( profiler.isTracing() )
+			{
+				profiler.traceSpan( "Effect", ( *it )->displayName(), start );
+			}
 		}
 	}
 
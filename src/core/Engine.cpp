@@ -46,7 +46,7 @@ DummyTrackContainer * LmmsCore::s_dummyTC = NULL;
 
 
 
-void LmmsCore::init( bool renderOnly )
+void LmmsCore::init( bool renderOnly, int threads )
 {
 	LmmsCore *engine = inst();
 
@@ -56,7 +56,7 @@ void LmmsCore::init( bool renderOnly )
 
 	emit engine->initProgress(tr("Initializing data structures"));
 	s_projectJournal = new ProjectJournal;
-	s_mixer = new Mixer( renderOnly );
+	s_mixer = new Mixer( renderOnly, threads );
 	s_song = new Song;
 	s_fxMixer = new FxMixer;
 	s_bbTrackContainer = new BBTrackContainer;
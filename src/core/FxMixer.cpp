@@ -24,6 +24,7 @@
 
 #include <QDomElement>
 
+#include "AudioPort.h"
 #include "BufferManager.h"
 #include "FxMixer.h"
 #include "Mixer.h"
@@ -68,9 +69,9 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 	m_soloModel( false, _parent ),
 	m_volumeModel( 1.0, 0.0, 2.0, 0.001, _parent ),
 	m_name(),
-	m_lock(),
 	m_channelIndex( idx ),
 	m_queued( false ),
+	m_dependencies( 0 ),
 	m_dependenciesMet(0)
 {
 	BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
@@ -99,7 +100,7 @@ inline void FxChannel::processed()
 void FxChannel::incrementDeps()
 {
 	int i = m_dependenciesMet++ + 1;
-	if( i >= m_receives.size() && ! m_queued )
+	if( i >= m_dependencies && ! m_queued )
 	{
 		m_queued = true;
 		MixerWorkerThread::addJob( this );
@@ -120,6 +121,17 @@ void FxChannel::doProcessing()
 
 	if( m_muted == false )
 	{
+		// pull output of all audio ports sending to us - they're summed in
+		// a fixed order so the result doesn't depend on thread timing
+		for( AudioPort * port : m_inputPorts )
+		{
+			if( port->m_hasOutput )
+			{
+				MixHelpers::add( m_buffer, port->buffer(), fpp );
+				m_hasInput = true;
+			}
+		}
+
 		for( FxRoute * senderRoute : m_receives )
 		{
 			FxChannel * sender = senderRoute->sender();
@@ -541,20 +553,6 @@ FloatModel * FxMixer::channelSendModel( fx_ch_t fromChannel, fx_ch_t toChannel )
 
 
 
-void FxMixer::mixToChannel( const sampleFrame * _buf, fx_ch_t _ch )
-{
-	if( m_fxChannels[_ch]->m_muteModel.value() == false )
-	{
-		m_fxChannels[_ch]->m_lock.lock();
-		MixHelpers::add( m_fxChannels[_ch]->m_buffer, _buf, Engine::mixer()->framesPerPeriod() );
-		m_fxChannels[_ch]->m_hasInput = true;
-		m_fxChannels[_ch]->m_lock.unlock();
-	}
-}
-
-
-
-
 void FxMixer::prepareMasterMix()
 {
 	BufferManager::clear( m_fxChannels[0]->m_buffer,
@@ -563,51 +561,58 @@ void FxMixer::prepareMasterMix()
 
 
 
-void FxMixer::masterMix( sampleFrame * _buf )
+void FxMixer::queueChannels( const QVector<AudioPort *> & _ports )
 {
-	const int fpp = Engine::mixer()->framesPerPeriod();
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_muted = ch->m_muteModel.value();
+		ch->m_inputPorts.clear();
+	}
+
+	// each audio port becomes a dependency of the channel it sends to
+	for( AudioPort * port : _ports )
+	{
+		const fx_ch_t index = port->nextFxChannel();
+		FxChannel * ch = index < m_fxChannels.size() ? m_fxChannels[index] : NULL;
+		port->m_fxChannel = ch && ch->m_muted == false ? ch : NULL;
+		if( port->m_fxChannel )
+		{
+			ch->m_inputPorts.append( port );
+		}
+	}
+
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_dependencies = ch->m_inputPorts.size() + ch->m_receives.size();
+	}
 
-	// add the channels that have no dependencies (no incoming senders, ie.
-	// no receives) to the jobqueue. The channels that have receives get
-	// added when their senders get processed, which is detected by
-	// dependency counting.
+	// add the channels that have no dependencies (no incoming senders and
+	// no audio ports, ie. no receives) to the jobqueue. The channels that
+	// have receives get added when their senders get processed, which is
+	// detected by dependency counting.
 	// also instantly add all muted channels as they don't need to care
 	// about their senders, and can just increment the deps of their
 	// recipients right away.
-	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
 	for( FxChannel * ch : m_fxChannels )
 	{
-		ch->m_muted = ch->m_muteModel.value();
 		if( ch->m_muted ) // instantly "process" muted channels
 		{
 			ch->processed();
 			ch->done();
 		}
-		else if( ch->m_receives.size() == 0 )
+		else if( ch->m_dependencies == 0 )
 		{
 			ch->m_queued = true;
 			MixerWorkerThread::addJob( ch );
 		}
 	}
-	while (m_fxChannels[0]->state() != ThreadableJob::ProcessingState::Done)
-	{
-		bool found = false;
-		for( FxChannel * ch : m_fxChannels )
-		{
-			const auto s = ch->state();
-			if (s == ThreadableJob::ProcessingState::Queued
-				|| s == ThreadableJob::ProcessingState::InProgress)
-			{
-				found = true;
-				break;
-			}
-		}
-		if( !found )
-		{
-			break;
-		}
-		MixerWorkerThread::startAndWaitForJobs();
-	}
+}
+
+
+
+void FxMixer::masterMix( sampleFrame * _buf )
+{
+	const int fpp = Engine::mixer()->framesPerPeriod();
 
 	// handle sample-exact data in master volume fader
 	ValueBuffer * volBuf = m_fxChannels[0]->m_volumeModel.valueBuffer();
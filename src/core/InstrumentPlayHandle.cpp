@@ -25,6 +25,8 @@
 
 #include "InstrumentPlayHandle.h"
 #include "InstrumentTrack.h"
+#include "Engine.h"
+#include "Mixer.h"
 
 InstrumentPlayHandle::InstrumentPlayHandle( Instrument * instrument, InstrumentTrack* instrumentTrack ) :
 		PlayHandle( TypeInstrumentPlayHandle ),
@@ -32,3 +34,23 @@ InstrumentPlayHandle::InstrumentPlayHandle( Instrument * instrument, InstrumentT
 {
 	setAudioPort( instrumentTrack->audioPort() );
 }
+
+
+
+
+void InstrumentPlayHandle::startRendering()
+{
+	// instruments which started on the period already wouldn't see the
+	// events before the next one, so they have to render synchronously
+	// in play() then
+	for( const PlayHandle * handle : Engine::mixer()->playHandles() )
+	{
+		if( handle->type() == TypeNotePlayHandle && handle->isFromTrack( m_instrument->instrumentTrack() ) &&
+			static_cast<const NotePlayHandle *>( handle )->sendsEventsThisPeriod() )
+		{
+			return;
+		}
+	}
+
+	m_instrument->startRendering();
+}
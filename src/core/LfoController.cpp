@@ -81,6 +81,14 @@ LfoController::~LfoController()
 }
 
 
+void LfoController::addDependencies()
+{
+	dependsOn( &m_baseModel );
+	dependsOn( &m_amountModel );
+	dependsOn( &m_phaseModel );
+}
+
+
 void LfoController::updateValueBuffer()
 {
 	m_phaseOffset = m_phaseModel.value() / 360.0;
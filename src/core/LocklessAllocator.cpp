@@ -24,16 +24,12 @@
 
 #include "LocklessAllocator.h"
 
-#include <algorithm>
 #include <stdio.h>
 
-#include "lmmsconfig.h"
 
-#ifndef LMMS_BUILD_WIN32
-#include <strings.h>
-#endif
-
-static const size_t SIZEOF_SET = sizeof( int ) * 8;
+static const uint32_t NO_ELEMENT = 0xffffffff;
+// marks elements which are handed out
+static const uint32_t IN_USE = 0xfffffffe;
 
 
 static size_t align( size_t size, size_t alignment )
@@ -47,20 +43,30 @@ static size_t align( size_t size, size_t alignment )
 }
 
 
+static inline uint64_t listHead( uint64_t prevHead, uint32_t index )
+{
+	return ( ( ( prevHead >> 32 ) + 1 ) << 32 ) | index;
+}
+
+
 
 
-LocklessAllocator::LocklessAllocator( size_t nmemb, size_t size )
+LocklessAllocator::LocklessAllocator( size_t nmemb, size_t size ) :
+	m_casRetries( 0 ),
+	m_exhaustions( 0 )
 {
-	m_capacity = align( nmemb, SIZEOF_SET );
+	m_capacity = nmemb;
 	m_elementSize = align( size, sizeof( void * ) );
 	m_pool = new char[m_capacity * m_elementSize];
 
-	m_freeStateSets = m_capacity / SIZEOF_SET;
-	m_freeState = new std::atomic_int[m_freeStateSets];
-	std::fill(m_freeState, m_freeState + m_freeStateSets, 0);
+	m_next = new std::atomic<uint32_t>[m_capacity];
+	for( size_t i = 0; i < m_capacity; ++i )
+	{
+		m_next[i] = i + 1 < m_capacity ? i + 1 : NO_ELEMENT;
+	}
+	m_freeList = m_capacity ? 0 : NO_ELEMENT;
 
 	m_available = m_capacity;
-	m_startIndex = 0;
 }
 
 
@@ -76,61 +82,36 @@ LocklessAllocator::~LocklessAllocator()
 	}
 
 	delete[] m_pool;
-	delete[] m_freeState;
-}
-
-
-
-
-#ifdef LMMS_BUILD_WIN32
-static int ffs( int i )
-{
-	if( !i )
-	{
-		return 0;
-	}
-	for( int j = 0;; )
-	{
-		if( i & 1 << j++ )
-		{
-			return j;
-		}
-	}
+	delete[] m_next;
 }
-#endif
 
 
 
 
 void * LocklessAllocator::alloc()
 {
-	// Some of these CAS loops could probably use relaxed atomics, as discussed
-	// in http://en.cppreference.com/w/cpp/atomic/atomic/compare_exchange.
-	// Let's use sequentially-consistent ops to be safe for now.
-	int available = m_available.load();
-	do
+	uint64_t head = m_freeList.load( std::memory_order_acquire );
+	for( ;; )
 	{
-		if( !available )
+		const uint32_t index = static_cast<uint32_t>( head );
+		if( index == NO_ELEMENT )
 		{
+			++m_exhaustions;
 			fprintf( stderr, "LocklessAllocator: No free space\n" );
 			return NULL;
 		}
-	}
-	while (!m_available.compare_exchange_weak(available, available - 1));
 
-	const size_t startIndex = m_startIndex++ % m_freeStateSets;
-	for (size_t set = startIndex;; set = ( set + 1 ) % m_freeStateSets)
-	{
-		for (int freeState = m_freeState[set]; freeState != -1;)
+		// might already be outdated if another thread took this element
+		// in the meantime, but then the tag has changed and the CAS fails
+		const uint32_t next = m_next[index].load( std::memory_order_relaxed );
+		if( m_freeList.compare_exchange_weak( head, listHead( head, next ),
+					std::memory_order_acquire, std::memory_order_acquire ) )
 		{
-			int bit = ffs( ~freeState ) - 1;
-			if (m_freeState[set].compare_exchange_weak(freeState,
-							freeState | 1 << bit ) )
-			{
-				return m_pool + ( SIZEOF_SET * set + bit )
-								* m_elementSize;
-			}
+			m_next[index].store( IN_USE, std::memory_order_relaxed );
+			--m_available;
+			return m_pool + index * m_elementSize;
 		}
+		m_casRetries.fetch_add( 1, std::memory_order_relaxed );
 	}
 }
 
@@ -151,14 +132,40 @@ invalid:
 	{
 		goto invalid;
 	}
-	size_t set = offset / SIZEOF_SET;
-	int bit = offset % SIZEOF_SET;
-	int mask = 1 << bit;
-	int prevState = m_freeState[set].fetch_and(~mask);
-	if ( !( prevState & mask ) )
+	const uint32_t index = offset;
+	// only claim the element if it's in use - on a double free it may be
+	// on the free list already, and overwriting its link would cut the list
+	uint32_t expected = IN_USE;
+	if( !m_next[index].compare_exchange_strong( expected, NO_ELEMENT,
+						std::memory_order_relaxed ) )
 	{
 		fprintf( stderr, "LocklessAllocator: Block not in use\n" );
 		return;
 	}
 	++m_available;
+
+	uint64_t head = m_freeList.load( std::memory_order_relaxed );
+	for( ;; )
+	{
+		m_next[index].store( static_cast<uint32_t>( head ), std::memory_order_relaxed );
+		if( m_freeList.compare_exchange_weak( head, listHead( head, index ),
+					std::memory_order_release, std::memory_order_relaxed ) )
+		{
+			return;
+		}
+		m_casRetries.fetch_add( 1, std::memory_order_relaxed );
+	}
+}
+
+
+
+
+LocklessAllocator::Statistics LocklessAllocator::statistics() const
+{
+	Statistics stats;
+	stats.capacity = m_capacity;
+	stats.available = m_available;
+	stats.casRetries = m_casRetries;
+	stats.exhaustions = m_exhaustions;
+	return stats;
 }
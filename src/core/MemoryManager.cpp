@@ -26,6 +26,7 @@
 #include "MemoryManager.h"
 
 #include <QtCore/QtGlobal>
+#include "BufferManager.h"
 #include "rpmalloc.h"
 
 /// Global static object handling rpmalloc intializing and finalizing
@@ -53,6 +54,8 @@ MemoryManager::ThreadGuard::ThreadGuard()
 MemoryManager::ThreadGuard::~ThreadGuard()
 {
 	if (--thread_guard_depth == 0) {
+		// cached buffers would be lost with this thread otherwise
+		BufferManager::releaseThreadCache();
 		rpmalloc_thread_finalize();
 	}
 }
@@ -23,6 +23,7 @@
  */
 
 #include "MixHelpers.h"
+#include "MixHelpersSimd.h"
 #include "lmms_math.h"
 #include "ValueBuffer.h"
 
@@ -53,7 +54,7 @@ static inline void run( sampleFrame* dst, const sample_t* srcLeft, const sample_
 
 
 
-bool isSilent( const sampleFrame* src, int frames )
+static bool scalarIsSilent( const sampleFrame* src, int frames )
 {
 	const float silenceThreshold = 0.0000001f;
 
@@ -70,7 +71,7 @@ bool isSilent( const sampleFrame* src, int frames )
 
 
 /*! \brief Function for sanitizing a buffer of infs/nans - returns true if those are found */
-bool sanitize( sampleFrame * src, int frames )
+static bool scalarSanitize( sampleFrame * src, int frames )
 {
 	bool found = false;
 	for( int f = 0; f < frames; ++f )
@@ -101,7 +102,7 @@ struct AddOp
 	}
 } ;
 
-void add( sampleFrame* dst, const sampleFrame* src, int frames )
+static void scalarAdd( sampleFrame* dst, const sampleFrame* src, int frames )
 {
 	run<>( dst, src, frames, AddOp() );
 }
@@ -122,7 +123,7 @@ struct AddMultipliedOp
 } ;
 
 
-void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+static void scalarAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, AddMultipliedOp(coeffSrc) );
 }
@@ -147,44 +148,44 @@ void addSwappedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeff
 }
 
 
-void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+static void scalarAddMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		dst[f][0] += src[f][0] * coeffSrc * coeffSrcBuf[f];
+		dst[f][1] += src[f][1] * coeffSrc * coeffSrcBuf[f];
 	}
 }
 
-void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+static void scalarAddMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
-		dst[f][1] += src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+		dst[f][0] += src[f][0] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
+		dst[f][1] += src[f][1] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 	}
 
 }
 
-void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+static void scalarAddSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, const float* coeffSrcBuf, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
-		dst[f][0] += ( isinf( src[f][0] ) || isnan( src[f][0] ) ) ? 0.0f : src[f][0] * coeffSrc * coeffSrcBuf->values()[f];
-		dst[f][1] += ( isinf( src[f][1] ) || isnan( src[f][1] ) ) ? 0.0f : src[f][1] * coeffSrc * coeffSrcBuf->values()[f];
+		dst[f][0] += ( isinf( src[f][0] ) || isnan( src[f][0] ) ) ? 0.0f : src[f][0] * coeffSrc * coeffSrcBuf[f];
+		dst[f][1] += ( isinf( src[f][1] ) || isnan( src[f][1] ) ) ? 0.0f : src[f][1] * coeffSrc * coeffSrcBuf[f];
 	}
 }
 
-void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+static void scalarAddSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, const float* coeffSrcBuf1, const float* coeffSrcBuf2, int frames )
 {
 	for( int f = 0; f < frames; ++f )
 	{
 		dst[f][0] += ( isinf( src[f][0] ) || isnan( src[f][0] ) )
 			? 0.0f
-			: src[f][0] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+			: src[f][0] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 		dst[f][1] += ( isinf( src[f][1] ) || isnan( src[f][1] ) )
 			? 0.0f
-			: src[f][1] * coeffSrcBuf1->values()[f] * coeffSrcBuf2->values()[f];
+			: src[f][1] * coeffSrcBuf1[f] * coeffSrcBuf2[f];
 	}
 
 }
@@ -203,7 +204,7 @@ struct AddSanitizedMultipliedOp
 	const float m_coeff;
 };
 
-void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+static void scalarAddSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, AddSanitizedMultipliedOp(coeffSrc) );
 }
@@ -228,7 +229,7 @@ struct AddMultipliedStereoOp
 } ;
 
 
-void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+static void scalarAddMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
 {
 
 	run<>( dst, src, frames, AddMultipliedStereoOp(coeffSrcLeft, coeffSrcRight) );
@@ -256,13 +257,33 @@ struct MultiplyAndAddMultipliedOp
 } ;
 
 
-void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+static void scalarMultiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
 {
 	run<>( dst, src, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
 
 
+static void scalarSumWithVolumeAndPanning( sampleFrame* dst, const sampleFrame* const* srcs, int srcCount,
+				const float* volume, int volumeStride, const float* panning, int panningStride, int frames )
+{
+	for( int f = 0; f < frames; ++f )
+	{
+		sampleFrame sum = { 0.0f, 0.0f };
+		for( int i = 0; i < srcCount; ++i )
+		{
+			sum[0] += srcs[i][f][0];
+			sum[1] += srcs[i][f][1];
+		}
+		const float v = volume[f * volumeStride] * 0.01f;
+		const float p = panning[f * panningStride] * 0.01f;
+		dst[f][0] = sum[0] * ( ( p <= 0 ? 1.0f : 1.0f - p ) * v );
+		dst[f][1] = sum[1] * ( ( p >= 0 ? 1.0f : 1.0f + p ) * v );
+	}
+}
+
+
+
 void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 										const sample_t* srcLeft,
 										const sample_t* srcRight,
@@ -271,5 +292,148 @@ void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 	run<>( dst, srcLeft, srcRight, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
+
+static const Kernels s_scalarKernels = {
+	"scalar",
+	&scalarIsSilent,
+	&scalarSanitize,
+	&scalarAdd,
+	&scalarAddMultiplied,
+	&scalarAddMultipliedByBuffer,
+	&scalarAddMultipliedByBuffers,
+	&scalarAddSanitizedMultiplied,
+	&scalarAddSanitizedMultipliedByBuffer,
+	&scalarAddSanitizedMultipliedByBuffers,
+	&scalarAddMultipliedStereo,
+	&scalarMultiplyAndAddMultiplied,
+	&scalarSumWithVolumeAndPanning
+} ;
+
+
+const Kernels & scalarKernels()
+{
+	return s_scalarKernels;
+}
+
+
+
+std::vector<const Kernels *> supportedKernels()
+{
+	std::vector<const Kernels *> kernels;
+	kernels.push_back( &s_scalarKernels );
+
+#if ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "sse2" ) && sse2Kernels )
+	{
+		kernels.push_back( sse2Kernels );
+	}
+	if( __builtin_cpu_supports( "avx2" ) && avx2Kernels )
+	{
+		kernels.push_back( avx2Kernels );
+	}
+	if( __builtin_cpu_supports( "avx512f" ) && avx512Kernels )
+	{
+		kernels.push_back( avx512Kernels );
+	}
+#endif
+
+	// NEON is mandatory on AArch64, so no need for a runtime check
+	if( neonKernels )
+	{
+		kernels.push_back( neonKernels );
+	}
+
+	return kernels;
+}
+
+
+
+// start with the scalar table (constant initialization) so that even callers
+// running before dynamic initialization of this file find a valid table
+static const Kernels * s_kernels = &s_scalarKernels;
+static const bool s_kernelsSelected = ( s_kernels = supportedKernels().back(), true );
+
+
+const Kernels & activeKernels()
+{
+	return *s_kernels;
+}
+
+
+
+
+bool isSilent( const sampleFrame* src, int frames )
+{
+	return s_kernels->isSilent( src, frames );
+}
+
+
+bool sanitize( sampleFrame * src, int frames )
+{
+	return s_kernels->sanitize( src, frames );
+}
+
+
+void add( sampleFrame* dst, const sampleFrame* src, int frames )
+{
+	s_kernels->add( dst, src, frames );
+}
+
+
+void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	s_kernels->addMultiplied( dst, src, coeffSrc, frames );
+}
+
+
+void addMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+{
+	s_kernels->addMultipliedByBuffer( dst, src, coeffSrc, coeffSrcBuf->values(), frames );
+}
+
+
+void addMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+{
+	s_kernels->addMultipliedByBuffers( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames );
+}
+
+
+void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
+{
+	s_kernels->addSanitizedMultiplied( dst, src, coeffSrc, frames );
+}
+
+
+void addSanitizedMultipliedByBuffer( sampleFrame* dst, const sampleFrame* src, float coeffSrc, ValueBuffer * coeffSrcBuf, int frames )
+{
+	s_kernels->addSanitizedMultipliedByBuffer( dst, src, coeffSrc, coeffSrcBuf->values(), frames );
+}
+
+
+void addSanitizedMultipliedByBuffers( sampleFrame* dst, const sampleFrame* src, ValueBuffer * coeffSrcBuf1, ValueBuffer * coeffSrcBuf2, int frames )
+{
+	s_kernels->addSanitizedMultipliedByBuffers( dst, src, coeffSrcBuf1->values(), coeffSrcBuf2->values(), frames );
+}
+
+
+void addMultipliedStereo( sampleFrame* dst, const sampleFrame* src, float coeffSrcLeft, float coeffSrcRight, int frames )
+{
+	s_kernels->addMultipliedStereo( dst, src, coeffSrcLeft, coeffSrcRight, frames );
+}
+
+
+void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffDst, float coeffSrc, int frames )
+{
+	s_kernels->multiplyAndAddMultiplied( dst, src, coeffDst, coeffSrc, frames );
 }
 
+
+
+void sumWithVolumeAndPanning( sampleFrame* dst, const sampleFrame* const* srcs, int srcCount,
+				const float* volume, int volumeStride, const float* panning, int panningStride, int frames )
+{
+	s_kernels->sumWithVolumeAndPanning( dst, srcs, srcCount, volume, volumeStride, panning, panningStride, frames );
+}
+
+}
@@ -0,0 +1,79 @@
+/*
+ * MixHelpersAvx2.cpp - AVX2 implementation of MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "MixHelpersSimd.h"
+
+#ifdef __AVX2__
+
+#include <immintrin.h>
+
+#include "MixHelpersSimdKernels.h"
+
+namespace MixHelpers
+{
+
+namespace
+{
+
+struct Avx2
+{
+	typedef __m256 V;
+	typedef __m256 M;
+	enum { Width = 8 };
+
+	static inline V load( const float* p ) { return _mm256_loadu_ps( p ); }
+	static inline void store( float* p, V v ) { _mm256_storeu_ps( p, v ); }
+	static inline V set1( float x ) { return _mm256_set1_ps( x ); }
+	static inline V stereo( float l, float r ) { return _mm256_setr_ps( l, r, l, r, l, r, l, r ); }
+	static inline V perFrame( const float* p )
+	{
+		return _mm256_permutevar8x32_ps( _mm256_castps128_ps256( _mm_loadu_ps( p ) ),
+							_mm256_setr_epi32( 0, 0, 1, 1, 2, 2, 3, 3 ) );
+	}
+
+	static inline V add( V a, V b ) { return _mm256_add_ps( a, b ); }
+	static inline V mul( V a, V b ) { return _mm256_mul_ps( a, b ); }
+	static inline V min( V a, V b ) { return _mm256_min_ps( a, b ); }
+	static inline V max( V a, V b ) { return _mm256_max_ps( a, b ); }
+	static inline V abs( V a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ); }
+
+	static inline M finite( V a ) { return _mm256_cmp_ps( _mm256_sub_ps( a, a ), _mm256_setzero_ps(), _CMP_EQ_OQ ); }
+	static inline V keep( M m, V a ) { return _mm256_and_ps( m, a ); }
+	static inline bool all( M m ) { return _mm256_movemask_ps( m ) == 0xff; }
+	static inline bool anyGreaterEqual( V a, V b ) { return _mm256_movemask_ps( _mm256_cmp_ps( a, b, _CMP_GE_OQ ) ) != 0; }
+} ;
+
+}
+
+
+// constant initialized, so nothing in here runs before the CPU was checked
+constexpr Kernels s_avx2Kernels = makeKernels<Avx2>( "AVX2" );
+
+const Kernels * const avx2Kernels = &s_avx2Kernels;
+
+}
+
+#else
+
+const MixHelpers::Kernels * const MixHelpers::avx2Kernels = nullptr;
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * MixHelpersAvx512.cpp - AVX-512 implementation of MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "MixHelpersSimd.h"
+
+#ifdef __AVX512F__
+
+#include <immintrin.h>
+
+#include "MixHelpersSimdKernels.h"
+
+namespace MixHelpers
+{
+
+namespace
+{
+
+struct Avx512
+{
+	typedef __m512 V;
+	typedef __mmask16 M;
+	enum { Width = 16 };
+
+	static inline V load( const float* p ) { return _mm512_loadu_ps( p ); }
+	static inline void store( float* p, V v ) { _mm512_storeu_ps( p, v ); }
+	static inline V set1( float x ) { return _mm512_set1_ps( x ); }
+	static inline V stereo( float l, float r ) { return _mm512_set4_ps( r, l, r, l ); }
+	static inline V perFrame( const float* p )
+	{
+		// zero masked variants here and for min/max - the plain ones start from
+		// an undefined vector, which makes GCC 12 warn about uninitialized use
+		return _mm512_maskz_permutexvar_ps( 0xffff,
+						_mm512_setr_epi32( 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7 ),
+						_mm512_maskz_loadu_ps( 0x00ff, p ) );
+	}
+
+	static inline V add( V a, V b ) { return _mm512_add_ps( a, b ); }
+	static inline V mul( V a, V b ) { return _mm512_mul_ps( a, b ); }
+	static inline V min( V a, V b ) { return _mm512_maskz_min_ps( 0xffff, a, b ); }
+	static inline V max( V a, V b ) { return _mm512_maskz_max_ps( 0xffff, a, b ); }
+	static inline V abs( V a ) { return _mm512_abs_ps( a ); }
+
+	static inline M finite( V a ) { return _mm512_cmp_ps_mask( _mm512_sub_ps( a, a ), _mm512_setzero_ps(), _CMP_EQ_OQ ); }
+	static inline V keep( M m, V a ) { return _mm512_maskz_mov_ps( m, a ); }
+	static inline bool all( M m ) { return m == 0xffff; }
+	static inline bool anyGreaterEqual( V a, V b ) { return _mm512_cmp_ps_mask( a, b, _CMP_GE_OQ ) != 0; }
+} ;
+
+}
+
+
+// constant initialized, so nothing in here runs before the CPU was checked
+constexpr Kernels s_avx512Kernels = makeKernels<Avx512>( "AVX-512" );
+
+const Kernels * const avx512Kernels = &s_avx512Kernels;
+
+}
+
+#else
+
+const MixHelpers::Kernels * const MixHelpers::avx512Kernels = nullptr;
+
+#endif
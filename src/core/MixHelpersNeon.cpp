@@ -0,0 +1,84 @@
+/*
+ * MixHelpersNeon.cpp - NEON implementation of MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "MixHelpersSimd.h"
+
+// horizontal reductions are only available on AArch64
+#if defined( __ARM_NEON ) && defined( __aarch64__ )
+
+#include <arm_neon.h>
+
+#include "MixHelpersSimdKernels.h"
+
+namespace MixHelpers
+{
+
+namespace
+{
+
+struct Neon
+{
+	typedef float32x4_t V;
+	typedef uint32x4_t M;
+	enum { Width = 4 };
+
+	static inline V load( const float* p ) { return vld1q_f32( p ); }
+	static inline void store( float* p, V v ) { vst1q_f32( p, v ); }
+	static inline V set1( float x ) { return vdupq_n_f32( x ); }
+	static inline V stereo( float l, float r )
+	{
+		const float c[4] = { l, r, l, r };
+		return vld1q_f32( c );
+	}
+	static inline V perFrame( const float* p )
+	{
+		const float32x2_t v = vld1_f32( p );
+		return vcombine_f32( vdup_lane_f32( v, 0 ), vdup_lane_f32( v, 1 ) );
+	}
+
+	static inline V add( V a, V b ) { return vaddq_f32( a, b ); }
+	static inline V mul( V a, V b ) { return vmulq_f32( a, b ); }
+	static inline V min( V a, V b ) { return vminq_f32( a, b ); }
+	static inline V max( V a, V b ) { return vmaxq_f32( a, b ); }
+	static inline V abs( V a ) { return vabsq_f32( a ); }
+
+	static inline M finite( V a ) { return vceqq_f32( vsubq_f32( a, a ), vdupq_n_f32( 0.0f ) ); }
+	static inline V keep( M m, V a ) { return vreinterpretq_f32_u32( vandq_u32( m, vreinterpretq_u32_f32( a ) ) ); }
+	static inline bool all( M m ) { return vminvq_u32( m ) != 0; }
+	static inline bool anyGreaterEqual( V a, V b ) { return vmaxvq_u32( vcgeq_f32( a, b ) ) != 0; }
+} ;
+
+}
+
+
+// constant initialized, so nothing in here runs before the CPU was checked
+constexpr Kernels s_neonKernels = makeKernels<Neon>( "NEON" );
+
+const Kernels * const neonKernels = &s_neonKernels;
+
+}
+
+#else
+
+const MixHelpers::Kernels * const MixHelpers::neonKernels = nullptr;
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * MixHelpersSse2.cpp - SSE2 implementation of MixHelpers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "MixHelpersSimd.h"
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+#include "MixHelpersSimdKernels.h"
+
+namespace MixHelpers
+{
+
+namespace
+{
+
+struct Sse2
+{
+	typedef __m128 V;
+	typedef __m128 M;
+	enum { Width = 4 };
+
+	static inline V load( const float* p ) { return _mm_loadu_ps( p ); }
+	static inline void store( float* p, V v ) { _mm_storeu_ps( p, v ); }
+	static inline V set1( float x ) { return _mm_set1_ps( x ); }
+	static inline V stereo( float l, float r ) { return _mm_setr_ps( l, r, l, r ); }
+	static inline V perFrame( const float* p )
+	{
+		const V v = _mm_castpd_ps( _mm_load_sd( reinterpret_cast<const double *>( p ) ) );
+		return _mm_unpacklo_ps( v, v );
+	}
+
+	static inline V add( V a, V b ) { return _mm_add_ps( a, b ); }
+	static inline V mul( V a, V b ) { return _mm_mul_ps( a, b ); }
+	static inline V min( V a, V b ) { return _mm_min_ps( a, b ); }
+	static inline V max( V a, V b ) { return _mm_max_ps( a, b ); }
+	static inline V abs( V a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+
+	static inline M finite( V a ) { return _mm_cmpeq_ps( _mm_sub_ps( a, a ), _mm_setzero_ps() ); }
+	static inline V keep( M m, V a ) { return _mm_and_ps( m, a ); }
+	static inline bool all( M m ) { return _mm_movemask_ps( m ) == 0xf; }
+	static inline bool anyGreaterEqual( V a, V b ) { return _mm_movemask_ps( _mm_cmpge_ps( a, b ) ) != 0; }
+} ;
+
+}
+
+
+// constant initialized, so nothing in here runs before the CPU was checked
+constexpr Kernels s_sse2Kernels = makeKernels<Sse2>( "SSE2" );
+
+const Kernels * const sse2Kernels = &s_sse2Kernels;
+
+}
+
+#else
+
+const MixHelpers::Kernels * const MixHelpers::sse2Kernels = nullptr;
+
+#endif
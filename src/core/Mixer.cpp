@@ -35,6 +35,8 @@
 #include "EnvelopeAndLfoParameters.h"
 #include "NotePlayHandle.h"
 #include "ConfigManager.h"
+#include "Controller.h"
+#include "InstrumentPlayHandle.h"
 #include "SamplePlayHandle.h"
 #include "MemoryHelper.h"
 
@@ -60,6 +62,7 @@
 #include "MidiDummy.h"
 
 #include "BufferManager.h"
+#include "StemExporter.h"
 
 typedef LocklessList<PlayHandle *>::Element LocklessListElement;
 
@@ -69,7 +72,7 @@ static thread_local bool s_renderingThread;
 
 
 
-Mixer::Mixer( bool renderOnly ) :
+Mixer::Mixer( bool renderOnly, int threads ) :
 	m_renderOnly( renderOnly ),
 	m_framesPerPeriod( DEFAULT_BUFFER_SIZE ),
 	m_inputBufferRead( 0 ),
@@ -77,7 +80,7 @@ Mixer::Mixer( bool renderOnly ) :
 	m_readBuf( NULL ),
 	m_writeBuf( NULL ),
 	m_workers(),
-	m_numWorkers( QThread::idealThreadCount()-1 ),
+	m_numWorkers( ( threads > 0 ? threads : QThread::idealThreadCount() ) - 1 ),
 	m_newPlayHandles( PlayHandle::MaxNumber ),
 	m_qualitySettings( qualitySettings::Mode_Draft ),
 	m_masterGain( 1.0f ),
@@ -87,6 +90,9 @@ Mixer::Mixer( bool renderOnly ) :
 	m_audioDevStartFailed( false ),
 	m_profiler(),
 	m_metronomeActive(false),
+	m_pipelinedRendering( false ),
+	m_stemExporter( NULL ),
+	m_renderThread( NULL ),
 	m_clearSignal( false ),
 	m_changesSignal( false ),
 	m_changes( 0 ),
@@ -130,8 +136,28 @@ Mixer::Mixer( bool renderOnly ) :
 		}
 	}
 
-	// allocte the FIFO from the determined size
-	m_fifo = new fifo( fifoSize );
+	m_pipelinedRendering = ConfigManager::inst()->value( "mixer",
+						"pipelinedrender" ).toInt();
+
+	const int flightRecorderPeriods = ConfigManager::inst()->value( "mixer",
+					"flightrecorderperiods" ).toInt();
+	if( flightRecorderPeriods > 0 )
+	{
+		m_profiler.setFlightRecorderDepth( flightRecorderPeriods );
+	}
+
+	// a configured depth takes precedence over the one derived from the
+	// buffer size
+	const int fifoDepth = ConfigManager::inst()->value( "mixer",
+						"fifodepth" ).toInt();
+	if( fifoDepth > 0 )
+	{
+		fifoSize = fifoDepth;
+	}
+
+	// allocate the FIFO from the determined size
+	m_fifo = new PeriodFifo( fifoSize, m_framesPerPeriod );
+	m_profiler.addLatencyHistogram( "Audio FIFO", &m_fifo->latency() );
 
 	// now that framesPerPeriod is fixed initialize global BufferManager
 	BufferManager::init( m_framesPerPeriod );
@@ -146,6 +172,8 @@ Mixer::Mixer( bool renderOnly ) :
 		m_bufferPool.push_back( m_readBuf );
 	}
 
+	m_profiler.setWorkerCount( m_numWorkers + 1 );
+
 	for( int i = 0; i < m_numWorkers+1; ++i )
 	{
 		MixerWorkerThread * wt = new MixerWorkerThread( this );
@@ -180,10 +208,7 @@ Mixer::~Mixer()
 		m_workers[w]->wait( 500 );
 	}
 
-	while( m_fifo->available() )
-	{
-		delete[] m_fifo->read();
-	}
+	m_profiler.removeLatencyHistogram( &m_fifo->latency() );
 	delete m_fifo;
 
 	delete m_audioDev;
@@ -344,6 +369,7 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	m_profiler.startPeriod();
 
 	s_renderingThread = true;
+	m_renderThread = QThread::currentThread();
 
 	static Song::PlayPos last_metro_pos = -1;
 
@@ -424,7 +450,9 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	fxMixer->prepareMasterMix();
 
 	// create play-handles for new notes, samples etc.
+	m_profiler.startDetail( MixerProfiler::SongProcessing );
 	song->processNextBuffer();
+	m_profiler.finishDetail( MixerProfiler::SongProcessing );
 
 	// add all play-handles that have to be added
 	for( LocklessListElement * e = m_newPlayHandles.popList(); e; )
@@ -435,43 +463,99 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 		e = next;
 	}
 
-	// STAGE 1: run and render all play handles
-	MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
+	// STAGE 0: update value buffers of all controllers in use, so play
+	// handles and effects only read them - peak controllers take the peak
+	// of the previous period and don't depend on the effects running below
+	m_profiler.startDetail( MixerProfiler::Controllers );
+	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+	Controller::queueControllers();
 	MixerWorkerThread::startAndWaitForJobs();
+	m_profiler.finishDetail( MixerProfiler::Controllers );
 
-	// removed all play handles which are done
-	for( PlayHandleList::Iterator it = m_playHandles.begin();
-						it != m_playHandles.end(); )
+	// let instruments running in other processes start on this period,
+	// so they render in parallel with the play handles below instead of
+	// keeping a worker thread waiting - unless their notes still send
+	// MIDI events below, see InstrumentPlayHandle::startRendering()
+	for( PlayHandle * handle : m_playHandles )
 	{
-		if( ( *it )->affinityMatters() &&
-			( *it )->affinity() != QThread::currentThread() )
+		if( handle->type() == PlayHandle::TypeInstrumentPlayHandle )
 		{
-			++it;
-			continue;
+			static_cast<InstrumentPlayHandle *>( handle )->startRendering();
+		}
+	}
+
+	const bool pipelined = m_pipelinedRendering && song->isExporting();
+
+	if( pipelined )
+	{
+		// STAGE 1+2: run and render all play handles, process effects of
+		// all instrument- and sampletracks and all FX channels in a single
+		// pass - each audio port gets queued as soon as all of its play
+		// handles have been rendered and each FX channel as soon as all
+		// of its inputs are ready, so effects of one track overlap with
+		// rendering of the others - accounted as play handle stage
+		m_profiler.startDetail( MixerProfiler::PlayHandles );
+		MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+		fxMixer->queueChannels( m_audioPorts );
+
+		for( AudioPort * port : m_audioPorts )
+		{
+			// reference held by the mixer until all jobs are queued
+			port->m_pendingPlayHandles = 1;
 		}
-		if( ( *it )->isFinished() )
+		for( PlayHandle * handle : m_playHandles )
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle )
+			if( handle->requiresProcessing() )
 			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
+				++handle->audioPort()->m_pendingPlayHandles;
+				MixerWorkerThread::addJob( handle );
 			}
-			else delete *it;
-			it = m_playHandles.erase( it );
 		}
-		else
+		for( AudioPort * port : m_audioPorts )
 		{
-			++it;
+			port->playHandleDone();
+		}
+		MixerWorkerThread::startAndWaitForJobs();
+
+		removeFinishedPlayHandles();
+		m_profiler.finishDetail( MixerProfiler::PlayHandles );
+	}
+	else
+	{
+		// STAGE 1: run and render all play handles
+		m_profiler.startDetail( MixerProfiler::PlayHandles );
+		MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
+		MixerWorkerThread::startAndWaitForJobs();
+
+		removeFinishedPlayHandles();
+		m_profiler.finishDetail( MixerProfiler::PlayHandles );
+
+		// STAGE 2: process effects of all instrument- and sampletracks
+		// and all FX channels - each FX channel gets queued as soon as the
+		// audio ports and channels sending to it are done
+		m_profiler.startDetail( MixerProfiler::Effects );
+		MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+		fxMixer->queueChannels( m_audioPorts );
+		for( AudioPort * port : m_audioPorts )
+		{
+			MixerWorkerThread::addJob( port );
 		}
+		MixerWorkerThread::startAndWaitForJobs();
+		m_profiler.finishDetail( MixerProfiler::Effects );
 	}
 
-	// STAGE 2: process effects of all instrument- and sampletracks
-	MixerWorkerThread::fillJobQueue<QVector<AudioPort *> >( m_audioPorts );
-	MixerWorkerThread::startAndWaitForJobs();
 
+	// grab output of single tracks and FX channels before the master mix
+	// clears the channels
+	if( m_stemExporter )
+	{
+		m_stemExporter->capture();
+	}
 
 	// STAGE 3: do master mix in FX mixer
+	m_profiler.startDetail( MixerProfiler::MasterMix );
 	fxMixer->masterMix( m_writeBuf );
+	m_profiler.finishDetail( MixerProfiler::MasterMix );
 
 
 	emit nextAudioBuffer( m_readBuf );
@@ -485,7 +569,10 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 
 	s_renderingThread = false;
 
-	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod );
+	// only a device pulling through the fifo plays in real time - exports
+	// and benchmarks render periods as fast as they can
+	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod,
+				hasFifoWriter() && !song->isExporting() );
 
 	return m_readBuf;
 }
@@ -493,6 +580,31 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 
 
 
+void Mixer::removeFinishedPlayHandles()
+{
+	for( PlayHandleList::Iterator it = m_playHandles.begin();
+						it != m_playHandles.end(); )
+	{
+		if( playHandleExpires( *it ) )
+		{
+			( *it )->audioPort()->removePlayHandle( ( *it ) );
+			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle )
+			{
+				NotePlayHandleManager::release( (NotePlayHandle*) *it );
+			}
+			else delete *it;
+			it = m_playHandles.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+
+
+
 void Mixer::clear()
 {
 	m_clearSignal = true;
@@ -672,9 +784,9 @@ void Mixer::removeAudioPort( AudioPort * _port )
 
 bool Mixer::addPlayHandle( PlayHandle* handle )
 {
-	if( criticalXRuns() == false )
+	// pushing fails if too many play handles were added within one period
+	if( criticalXRuns() == false && m_newPlayHandles.push( handle ) )
 	{
-		m_newPlayHandles.push( handle );
 		handle->audioPort()->addPlayHandle( handle );
 		return true;
 	}
@@ -1085,7 +1197,7 @@ MidiClient * Mixer::tryMidiClients()
 
 
 
-Mixer::fifoWriter::fifoWriter( Mixer* mixer, fifo * _fifo ) :
+Mixer::fifoWriter::fifoWriter( Mixer* mixer, PeriodFifo * _fifo ) :
 	m_mixer( mixer ),
 	m_fifo( _fifo ),
 	m_writing( true )
@@ -1119,13 +1231,9 @@ void Mixer::fifoWriter::run()
 #endif
 #endif
 
-	const fpp_t frames = m_mixer->framesPerPeriod();
 	while( m_writing )
 	{
-		surroundSampleFrame * buffer = new surroundSampleFrame[frames];
-		const surroundSampleFrame * b = m_mixer->renderNextBuffer();
-		memcpy( buffer, b, frames * sizeof( surroundSampleFrame ) );
-		write( buffer );
+		write( m_mixer->renderNextBuffer() );
 	}
 
 	write( NULL );
@@ -1134,14 +1242,22 @@ void Mixer::fifoWriter::run()
 
 
 
-void Mixer::fifoWriter::write( surroundSampleFrame * buffer )
+void Mixer::fifoWriter::write( const surroundSampleFrame * buffer )
 {
 	m_mixer->m_waitChangesMutex.lock();
 	m_mixer->m_waitingForWrite = true;
 	m_mixer->m_waitChangesMutex.unlock();
 	m_mixer->runChangesInModel();
 
-	m_fifo->write( buffer );
+	m_mixer->m_profiler.startDetail( MixerProfiler::FifoWrite );
+	// waits for the audio device if all buffers are queued
+	surroundSampleFrame * slot = m_fifo->beginWrite();
+	if( buffer )
+	{
+		memcpy( slot, buffer, m_mixer->framesPerPeriod() * sizeof( surroundSampleFrame ) );
+	}
+	m_fifo->endWrite( buffer == NULL );
+	m_mixer->m_profiler.finishDetail( MixerProfiler::FifoWrite );
 
 	m_mixer->m_doChangesMutex.lock();
 	m_mixer->m_waitingForWrite = false;
@@ -24,31 +24,558 @@
 
 #include "MixerProfiler.h"
 
+#include <QtCore/QDateTime>
+#include <QtCore/QThread>
+
+#include "ThreadableJob.h"
+
+
+// number of events each thread can trace per period - further events are
+// dropped so tracing never allocates while rendering
+static const int MAX_TRACE_EVENTS_PER_PERIOD = 4096;
+
+// number of periods kept by the flight recorder if not configured otherwise
+static const int DEFAULT_FLIGHT_RECORDER_DEPTH = 256;
+
+// number of periods of trace events which can wait for the writer thread -
+// further periods aren't traced until it caught up
+static const int TRACE_BATCHES = 16;
+
+// how often the writer threads look for something to write
+static const int XRUN_LOG_INTERVAL_MS = 50;
+static const int TRACE_INTERVAL_MS = 5;
+
+static thread_local int s_currentWorker = -1;
+
+
+
+// polls for flight recorder snapshots and trace events, so the mixer thread
+// never has to wake up anyone or touch the disk
+class ProfilerWriter : public QThread
+{
+public:
+	typedef void (MixerProfiler::*WriteFunction)();
+
+	ProfilerWriter( MixerProfiler * profiler, WriteFunction write,
+							int intervalMs ) :
+		m_profiler( profiler ),
+		m_write( write ),
+		m_intervalMs( intervalMs )
+	{
+	}
+
+private:
+	virtual void run()
+	{
+		while( !isInterruptionRequested() )
+		{
+			( m_profiler->*m_write )();
+			msleep( m_intervalMs );
+		}
+		( m_profiler->*m_write )();
+	}
+
+	MixerProfiler * m_profiler;
+	WriteFunction m_write;
+	int m_intervalMs;
+
+} ;
+
+
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+
+
+void LatencyHistogram::add( int usecs )
+{
+	int bucket = 0;
+	while( bucket < Buckets - 1 && usecs >= bucketLimit( bucket ) )
+	{
+		++bucket;
+	}
+	m_counts[bucket].fetch_add( 1, std::memory_order_relaxed );
+}
+
+
+
+void LatencyHistogram::reset()
+{
+	for( std::atomic<int> & count : m_counts )
+	{
+		count.store( 0, std::memory_order_relaxed );
+	}
+}
+
+
+
+int LatencyHistogram::percentile( const QVector<int> & counts, int percent )
+{
+	qint64 total = 0;
+	for( int count : counts )
+	{
+		total += count;
+	}
+	if( total == 0 )
+	{
+		return 0;
+	}
+
+	const qint64 rank = ( total * percent + 99 ) / 100;
+	qint64 seen = 0;
+	for( int bucket = 0; bucket < counts.size(); ++bucket )
+	{
+		seen += counts[bucket];
+		if( seen >= rank )
+		{
+			return bucketLimit( bucket );
+		}
+	}
+	return bucketLimit( counts.size() - 1 );
+}
+
+
 
 MixerProfiler::MixerProfiler() :
-	m_periodTimer(),
+	m_epoch( Clock::now() ),
+	m_periodStart( 0 ),
 	m_cpuLoad( 0 ),
-	m_outputFile()
+	m_outputFile(),
+	m_workers( 1 ),
+	m_xruns( 0 ),
+	m_offlineXruns( false ),
+	m_flightRecorder(),
+	m_flightRecorderPos( 0 ),
+	m_flightRecorderSize( 0 ),
+	m_snapshot(),
+	m_snapshotSize( 0 ),
+	m_snapshotPending( false ),
+	m_xrunLogFactor( 1.0f ),
+	m_xrunLog(),
+	m_xrunLogWriter( NULL ),
+	m_tracing( false ),
+	m_traceFile(),
+	m_firstTraceEvent( true ),
+	m_traceBatches(),
+	m_traceBatchesQueued( 0 ),
+	m_traceBatchesWritten( 0 ),
+	m_droppedTracePeriods( 0 ),
+	m_traceWriter( NULL ),
+	m_histogramsMutex(),
+	m_histograms(),
+	m_removedLatencies()
 {
+	for( int i = 0; i < DetailCount; ++i )
+	{
+		m_detailStart[i] = 0;
+		m_detailTime[i] = 0;
+	}
+
+	setFlightRecorderDepth( DEFAULT_FLIGHT_RECORDER_DEPTH );
 }
 
 
 
 MixerProfiler::~MixerProfiler()
 {
+	if( m_xrunLogWriter )
+	{
+		m_xrunLogWriter->requestInterruption();
+		m_xrunLogWriter->wait();
+		delete m_xrunLogWriter;
+	}
+	closeTrace();
+	writeLatencies();
+}
+
+
+
+
+void MixerProfiler::startPeriod()
+{
+	m_periodStart = timestamp();
 }
 
 
-void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod )
+
+
+void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod,
+								bool realtime )
 {
-	int periodElapsed = m_periodTimer.elapsed();
+	const int64_t now = timestamp();
+	const int periodElapsed = now - m_periodStart;
 
 	const float newCpuLoad = periodElapsed / 10000.0f * sampleRate / framesPerPeriod;
-    m_cpuLoad = qBound<int>( 0, ( newCpuLoad * 0.1f + m_cpuLoad * 0.9f ), 100 );
+	m_cpuLoad = qBound<int>( 0, ( newCpuLoad * 0.1f + m_cpuLoad * 0.9f ), 100 );
+
+	const int budget = (int64_t) framesPerPeriod * 1000000 / sampleRate;
+	recordPeriod( m_periodStart, periodElapsed, budget, realtime );
+
+	// all workers are idle at this point
+	for( WorkerSlot & slot : m_workers )
+	{
+		const int busy = slot.busy.exchange( 0, std::memory_order_relaxed );
+		slot.utilisation.store( periodElapsed > 0 ?
+					qMin( busy * 100 / periodElapsed, 100 ) : 0,
+					std::memory_order_relaxed );
+	}
 
 	if( m_outputFile.isOpen() )
 	{
-		m_outputFile.write( QString( "%1\n" ).arg( periodElapsed ).toLatin1() );
+		QString line = QString::number( periodElapsed );
+		for( int i = 0; i < DetailCount; ++i )
+		{
+			line += QString( "\t%1" ).arg( detailTime( (DetailType) i ) );
+		}
+		m_outputFile.write( ( line + "\n" ).toLatin1() );
+	}
+
+	if( isTracing() )
+	{
+		record( currentSlot(), "Mixer", "Period", m_periodStart, periodElapsed );
+		queueTrace();
+	}
+}
+
+
+
+
+void MixerProfiler::recordPeriod( int64_t start, int elapsed, int budget,
+								bool realtime )
+{
+	PeriodRecord & record = m_flightRecorder[m_flightRecorderPos];
+	record.start = start;
+	record.elapsed = elapsed;
+	record.budget = budget;
+	for( int i = 0; i < DetailCount; ++i )
+	{
+		// fifo write of this period is still to come, so this is the one
+		// of the previous period
+		record.details[i] = detailTime( (DetailType) i );
+	}
+	m_flightRecorderPos = ( m_flightRecorderPos + 1 ) % m_flightRecorder.size();
+	m_flightRecorderSize = qMin<int>( m_flightRecorderSize + 1, m_flightRecorder.size() );
+
+	// nobody waits for periods rendered as fast as possible
+	if( ( !realtime && !m_offlineXruns ) || elapsed <= budget )
+	{
+		return;
+	}
+
+	m_xruns.fetch_add( 1, std::memory_order_relaxed );
+
+	if( m_xrunLogWriter && elapsed > budget * m_xrunLogFactor &&
+			!m_snapshotPending.load( std::memory_order_acquire ) )
+	{
+		// copy oldest to newest
+		const int size = m_flightRecorder.size();
+		for( int i = 0; i < m_flightRecorderSize; ++i )
+		{
+			m_snapshot[i] = m_flightRecorder[( m_flightRecorderPos -
+						m_flightRecorderSize + i + size ) % size];
+		}
+		m_snapshotSize = m_flightRecorderSize;
+		m_snapshotPending.store( true, std::memory_order_release );
+	}
+}
+
+
+
+
+void MixerProfiler::setFlightRecorderDepth( int periods )
+{
+	periods = qMax( periods, 1 );
+	m_flightRecorder.assign( periods, PeriodRecord() );
+	m_snapshot.assign( periods, PeriodRecord() );
+	m_flightRecorderPos = 0;
+	m_flightRecorderSize = 0;
+}
+
+
+
+
+void MixerProfiler::setXrunLog( const QString & logFile, float factor )
+{
+	m_xrunLogFactor = qMax( factor, 1.0f );
+	if( m_xrunLogWriter )
+	{
+		return;
+	}
+
+	m_xrunLog.setFileName( logFile );
+	if( m_xrunLog.open( QFile::WriteOnly | QFile::Append ) )
+	{
+		m_xrunLogWriter = new ProfilerWriter( this,
+				&MixerProfiler::writeXrunSnapshot, XRUN_LOG_INTERVAL_MS );
+		m_xrunLogWriter->start( QThread::LowPriority );
+	}
+}
+
+
+
+
+void MixerProfiler::writeXrunSnapshot()
+{
+	if( !m_snapshotPending.load( std::memory_order_acquire ) )
+	{
+		return;
+	}
+
+	const PeriodRecord & xrun = m_snapshot[m_snapshotSize - 1];
+	m_xrunLog.write( QString( "# %1: period took %2 us, budget %3 us\n" ).
+				arg( QDateTime::currentDateTime().toString( Qt::ISODate ) ).
+				arg( xrun.elapsed ).arg( xrun.budget ).toLatin1() );
+
+	QString header = "# start\telapsed\tbudget";
+	for( int i = 0; i < DetailCount; ++i )
+	{
+		header += QString( "\t" ) + detailName( (DetailType) i );
+	}
+	m_xrunLog.write( ( header + "\n" ).toLatin1() );
+
+	for( int p = 0; p < m_snapshotSize; ++p )
+	{
+		const PeriodRecord & record = m_snapshot[p];
+		QString line = QString( "%1\t%2\t%3" ).arg( (qint64) record.start ).
+					arg( record.elapsed ).arg( record.budget );
+		for( int i = 0; i < DetailCount; ++i )
+		{
+			line += QString( "\t%1" ).arg( record.details[i] );
+		}
+		m_xrunLog.write( ( line + "\n" ).toLatin1() );
+	}
+	m_xrunLog.write( "\n" );
+	m_xrunLog.flush();
+
+	m_snapshotPending.store( false, std::memory_order_release );
+}
+
+
+
+
+void MixerProfiler::finishDetail( DetailType type )
+{
+	const int duration = timestamp() - m_detailStart[type];
+	m_detailTime[type].store( duration, std::memory_order_relaxed );
+
+	if( isTracing() )
+	{
+		record( currentSlot(), "Stage", detailName( type ),
+						m_detailStart[type], duration );
+	}
+}
+
+
+
+
+const char * MixerProfiler::detailName( DetailType type )
+{
+	switch( type )
+	{
+		case Controllers: return "Controllers";
+		case SongProcessing: return "Song processing";
+		case PlayHandles: return "Play handles";
+		case Effects: return "Effects";
+		case MasterMix: return "Master mix";
+		case FifoWrite: return "FIFO write";
+		default: break;
+	}
+	return "";
+}
+
+
+
+
+void MixerProfiler::setWorkerCount( int workers )
+{
+	m_workers.resize( qMax( workers, 1 ) );
+	for( WorkerSlot & slot : m_workers )
+	{
+		slot.events.resize( MAX_TRACE_EVENTS_PER_PERIOD );
+	}
+}
+
+
+
+
+void MixerProfiler::setCurrentWorker( int worker )
+{
+	s_currentWorker = worker;
+}
+
+
+
+
+void MixerProfiler::finishJob( const ThreadableJob * job, int64_t start )
+{
+	const int duration = timestamp() - start;
+	WorkerSlot & slot = currentSlot();
+	slot.busy.fetch_add( duration, std::memory_order_relaxed );
+
+	if( isTracing() )
+	{
+		record( slot, job->jobCategory(), job->jobName(), start, duration );
+	}
+}
+
+
+
+
+void MixerProfiler::traceSpan( const char * category, const QString & name, int64_t start )
+{
+	record( currentSlot(), category, name, start, timestamp() - start );
+}
+
+
+
+
+MixerProfiler::WorkerSlot & MixerProfiler::currentSlot()
+{
+	if( s_currentWorker >= 0 && s_currentWorker < (int) m_workers.size() )
+	{
+		return m_workers[s_currentWorker];
+	}
+	return m_workers.back();
+}
+
+
+
+
+void MixerProfiler::record( WorkerSlot & slot, const char * category,
+					const QString & name, int64_t start, int duration )
+{
+	if( slot.numEvents >= (int) slot.events.size() )
+	{
+		++slot.droppedEvents;
+		return;
+	}
+	TraceEvent & event = slot.events[slot.numEvents++];
+	event.category = category;
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+}
+
+
+
+
+static QByteArray escapeJson( const QString & s )
+{
+	QByteArray out;
+	for( const QChar c : s )
+	{
+		if( c == '"' || c == '\\' )
+		{
+			out += '\\';
+			out += c.toLatin1();
+		}
+		else if( c.unicode() < 0x20 )
+		{
+			out += QString( "\\u%1" ).arg( c.unicode(), 4, 16, QChar( '0' ) ).toLatin1();
+		}
+		else
+		{
+			out += QString( c ).toUtf8();
+		}
+	}
+	return out;
+}
+
+
+
+
+void MixerProfiler::queueTrace()
+{
+	const int64_t queued = m_traceBatchesQueued.load( std::memory_order_relaxed );
+	if( queued - m_traceBatchesWritten.load( std::memory_order_acquire ) >=
+							(int64_t) m_traceBatches.size() )
+	{
+		// writer is behind - the names are released when the events
+		// get overwritten
+		m_droppedTracePeriods.fetch_add( 1, std::memory_order_relaxed );
+		for( WorkerSlot & slot : m_workers )
+		{
+			slot.numEvents = 0;
+			slot.droppedEvents = 0;
+		}
+		return;
+	}
+
+	TraceBatch & batch = m_traceBatches[queued % m_traceBatches.size()];
+	for( int tid = 0; tid < (int) m_workers.size(); ++tid )
+	{
+		WorkerSlot & slot = m_workers[tid];
+		slot.events.swap( batch.events[tid] );
+		batch.numEvents[tid] = slot.numEvents;
+		batch.droppedEvents[tid] = slot.droppedEvents;
+		slot.numEvents = 0;
+		slot.droppedEvents = 0;
+	}
+	m_traceBatchesQueued.store( queued + 1, std::memory_order_release );
+}
+
+
+
+
+void MixerProfiler::writeTraceBatches()
+{
+	int64_t written = m_traceBatchesWritten.load( std::memory_order_relaxed );
+	while( written < m_traceBatchesQueued.load( std::memory_order_acquire ) )
+	{
+		TraceBatch & batch = m_traceBatches[written % m_traceBatches.size()];
+		for( int tid = 0; tid < (int) batch.events.size(); ++tid )
+		{
+			std::vector<TraceEvent> & events = batch.events[tid];
+			for( int i = 0; i < batch.numEvents[tid]; ++i )
+			{
+				const TraceEvent & event = events[i];
+				m_traceFile.write( m_firstTraceEvent ? "\n" : ",\n" );
+				m_firstTraceEvent = false;
+				m_traceFile.write( "{\"name\":\"" + escapeJson( event.name ) +
+						"\",\"cat\":\"" + event.category +
+						"\",\"ph\":\"X\",\"ts\":" + QByteArray::number( (qint64) event.start ) +
+						",\"dur\":" + QByteArray::number( event.duration ) +
+						",\"pid\":1,\"tid\":" + QByteArray::number( tid ) + "}" );
+				// drop reference to the name right away
+				events[i].name = QString();
+			}
+			if( batch.droppedEvents[tid] )
+			{
+				qWarning( "MixerProfiler: dropped %d trace events",
+							batch.droppedEvents[tid] );
+			}
+		}
+		m_traceBatchesWritten.store( ++written, std::memory_order_release );
+	}
+}
+
+
+
+
+void MixerProfiler::closeTrace()
+{
+	m_tracing = false;
+	if( m_traceWriter )
+	{
+		// writes out what is left
+		m_traceWriter->requestInterruption();
+		m_traceWriter->wait();
+		delete m_traceWriter;
+		m_traceWriter = NULL;
+	}
+	if( m_droppedTracePeriods )
+	{
+		qWarning( "MixerProfiler: did not trace %d periods as the writer "
+				"fell behind", m_droppedTracePeriods.load() );
+		m_droppedTracePeriods = 0;
+	}
+	if( m_traceFile.isOpen() )
+	{
+		m_traceFile.write( "\n]\n" );
+		m_traceFile.close();
 	}
 }
 
@@ -61,3 +588,135 @@ void MixerProfiler::setOutputFile( const QString& outputFile )
 	m_outputFile.open( QFile::WriteOnly | QFile::Truncate );
 }
 
+
+
+
+void MixerProfiler::setTraceFile( const QString& traceFile )
+{
+	closeTrace();
+	m_traceFile.setFileName( traceFile );
+	if( m_traceFile.open( QFile::WriteOnly | QFile::Truncate ) )
+	{
+		m_traceFile.write( "[" );
+		m_firstTraceEvent = true;
+
+		// name the threads in the viewer
+		for( int tid = 0; tid < (int) m_workers.size(); ++tid )
+		{
+			m_traceFile.write( m_firstTraceEvent ? "\n" : ",\n" );
+			m_firstTraceEvent = false;
+			const QByteArray name = tid + 1 < (int) m_workers.size() ?
+				"Worker " + QByteArray::number( tid ) : QByteArray( "Mixer" );
+			m_traceFile.write( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" +
+					QByteArray::number( tid ) + ",\"args\":{\"name\":\"" + name + "\"}}" );
+		}
+
+		m_traceBatches.assign( TRACE_BATCHES, TraceBatch() );
+		for( TraceBatch & batch : m_traceBatches )
+		{
+			batch.events.resize( m_workers.size() );
+			for( std::vector<TraceEvent> & events : batch.events )
+			{
+				events.resize( MAX_TRACE_EVENTS_PER_PERIOD );
+			}
+			batch.numEvents.assign( m_workers.size(), 0 );
+			batch.droppedEvents.assign( m_workers.size(), 0 );
+		}
+		m_traceBatchesQueued = 0;
+		m_traceBatchesWritten = 0;
+
+		m_traceWriter = new ProfilerWriter( this,
+				&MixerProfiler::writeTraceBatches, TRACE_INTERVAL_MS );
+		m_traceWriter->start( QThread::LowPriority );
+		m_tracing = true;
+	}
+}
+
+
+
+
+void MixerProfiler::addLatencyHistogram( const QString & name, const LatencyHistogram * histogram )
+{
+	QMutexLocker lock( &m_histogramsMutex );
+	m_histograms.append( qMakePair( name, histogram ) );
+}
+
+
+
+void MixerProfiler::removeLatencyHistogram( const LatencyHistogram * histogram )
+{
+	QMutexLocker lock( &m_histogramsMutex );
+	for( int i = 0; i < m_histograms.size(); ++i )
+	{
+		if( m_histograms[i].second == histogram )
+		{
+			// keep what it counted for the summary
+			Latencies latencies;
+			latencies.name = m_histograms[i].first;
+			int total = 0;
+			for( int b = 0; b < LatencyHistogram::Buckets; ++b )
+			{
+				latencies.counts.append( histogram->count( b ) );
+				total += latencies.counts.last();
+			}
+			if( total > 0 )
+			{
+				m_removedLatencies.append( latencies );
+			}
+
+			m_histograms.removeAt( i );
+			break;
+		}
+	}
+}
+
+
+
+QList<MixerProfiler::Latencies> MixerProfiler::latencies() const
+{
+	QMutexLocker lock( &m_histogramsMutex );
+	QList<Latencies> result;
+	for( const auto & entry : m_histograms )
+	{
+		Latencies latencies;
+		latencies.name = entry.first;
+		for( int i = 0; i < LatencyHistogram::Buckets; ++i )
+		{
+			latencies.counts.append( entry.second->count( i ) );
+		}
+		result.append( latencies );
+	}
+	return result;
+}
+
+
+
+
+void MixerProfiler::writeLatencies()
+{
+	if( !m_outputFile.isOpen() )
+	{
+		return;
+	}
+
+	const QList<Latencies> all = m_removedLatencies + latencies();
+	for( const Latencies & latencies : all )
+	{
+		int total = 0;
+		for( int count : latencies.counts )
+		{
+			total += count;
+		}
+		if( total == 0 )
+		{
+			continue;
+		}
+		m_outputFile.write( QString( "# %1: %2 samples, p50 < %3 us, "
+						"p99 < %4 us\n" ).
+				arg( latencies.name ).arg( total ).
+				arg( LatencyHistogram::percentile( latencies.counts, 50 ) ).
+				arg( LatencyHistogram::percentile( latencies.counts, 99 ) ).
+								toUtf8() );
+	}
+	m_outputFile.flush();
+}
@@ -26,22 +26,161 @@
 
 #include <xmmintrin.h>
 #include <QDebug>
-#include <QMutex>
-#include <QWaitCondition>
 
 #include "denormals.h"
 #include "ThreadableJob.h"
 #include "Mixer.h"
 
 MixerWorkerThread::JobQueue MixerWorkerThread::globalJobQueue;
-QWaitCondition * MixerWorkerThread::queueReadyWaitCond = NULL;
+MixerProfiler * MixerWorkerThread::profiler = nullptr;
 QList<MixerWorkerThread *> MixerWorkerThread::workerThreads;
 
+static thread_local MixerWorkerThread * s_currentWorker = nullptr;
+
+// number of unsuccessful attempts to find a job before a worker goes idle -
+// in dynamic mode new jobs are likely to show up soon, so try harder there
+static const int STATIC_IDLE_ROUNDS = 64;
+static const int DYNAMIC_IDLE_ROUNDS = 4096;
+
+// number of spins the waiting thread does before parking itself
+static const int WAIT_SPIN_ROUNDS = 2048;
+
+
+static inline void cpuRelax()
+{
+#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
+	_mm_pause();
+#endif
+}
+
+
+
+
+// implementation of Parker
+void MixerWorkerThread::Parker::park()
+{
+	// fast path: consume a pending token without touching the mutex
+	int expected = Notified;
+	if( m_state.compare_exchange_strong( expected, Empty ) )
+	{
+		return;
+	}
+
+	QMutexLocker lock( &m_mutex );
+	expected = Empty;
+	if( !m_state.compare_exchange_strong( expected, Parked ) )
+	{
+		// got notified in the meantime
+		m_state = Empty;
+		return;
+	}
+
+	while( true )
+	{
+		m_cond.wait( &m_mutex );
+		expected = Notified;
+		if( m_state.compare_exchange_strong( expected, Empty ) )
+		{
+			return;
+		}
+		// spurious wakeup - park again
+	}
+}
+
+
+
+
+void MixerWorkerThread::Parker::unpark()
+{
+	if( m_state.exchange( Notified ) == Parked )
+	{
+		// lock and unlock the mutex so we can't signal in between the
+		// parking thread's state change and its call to wait()
+		m_mutex.lock();
+		m_mutex.unlock();
+		m_cond.wakeOne();
+	}
+}
+
+
+
+
+// implementation of JobDeque
+bool MixerWorkerThread::JobDeque::push( ThreadableJob * _job )
+{
+	const int64_t b = m_bottom.load( std::memory_order_relaxed );
+	const int64_t t = m_top.load( std::memory_order_acquire );
+	if( b - t >= JOB_QUEUE_SIZE )
+	{
+		return false;
+	}
+	m_items[b & ( JOB_QUEUE_SIZE - 1 )].store( _job, std::memory_order_relaxed );
+	m_bottom.store( b + 1, std::memory_order_release );
+	return true;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobDeque::pop()
+{
+	const int64_t b = m_bottom.load( std::memory_order_relaxed ) - 1;
+	m_bottom.store( b, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t t = m_top.load( std::memory_order_relaxed );
+
+	if( t > b )
+	{
+		// deque was empty
+		m_bottom.store( b + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	ThreadableJob * job = m_items[b & ( JOB_QUEUE_SIZE - 1 )].load( std::memory_order_relaxed );
+	if( t == b )
+	{
+		// last item - race against thieves
+		if( !m_top.compare_exchange_strong( t, t + 1,
+						std::memory_order_seq_cst, std::memory_order_relaxed ) )
+		{
+			job = nullptr;
+		}
+		m_bottom.store( b + 1, std::memory_order_relaxed );
+	}
+	return job;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobDeque::steal()
+{
+	int64_t t = m_top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	const int64_t b = m_bottom.load( std::memory_order_acquire );
+
+	if( t >= b )
+	{
+		return nullptr;
+	}
+
+	ThreadableJob * job = m_items[t & ( JOB_QUEUE_SIZE - 1 )].load( std::memory_order_relaxed );
+	if( !m_top.compare_exchange_strong( t, t + 1,
+					std::memory_order_seq_cst, std::memory_order_relaxed ) )
+	{
+		// lost race against owner or another thief
+		return nullptr;
+	}
+	return job;
+}
+
+
+
+
 // implementation of internal JobQueue
 void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
 {
-	m_writeIndex = 0;
-	m_itemsDone = 0;
+	m_seeded = 0;
 	m_opMode = _opMode;
 }
 
@@ -54,50 +193,193 @@ void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 	{
 		// update job state
 		_job->queue();
-		// actually queue the job via atomic operations
-		auto index = m_writeIndex++;
-		if (index < JOB_QUEUE_SIZE) {
-			m_items[index] = _job;
-		} else {
+
+		MixerWorkerThread * target;
+		if( m_running )
+		{
+			// called from within a job - keep it local, idle threads
+			// will steal it if they run out of work
+			target = currentWorker();
+		}
+		else
+		{
+			// workers are parked, so distribute jobs round-robin
+			// starting with the deque of the calling thread
+			const int n = workerThreads.size();
+			target = workerThreads[( n - 1 + m_seeded ) % n];
+			++m_seeded;
+		}
+
+		++m_pending;
+		if( !target->m_jobs.push( _job ) )
+		{
 			qWarning() << "Job queue is full!";
-			++m_itemsDone;
+			_job->process();
+			jobDone();
+		}
+		else if( m_running )
+		{
+			// workers which have been left parked or already went
+			// idle would never see the new job otherwise
+			wakeIdleWorker();
 		}
 	}
 }
 
 
 
-void MixerWorkerThread::JobQueue::run()
+
+void MixerWorkerThread::JobQueue::runAndWait()
 {
-	bool processedJob = true;
-	while (processedJob && m_itemsDone < m_writeIndex)
+	if( m_pending == 0 )
 	{
-		processedJob = false;
-		for( int i = 0; i < m_writeIndex && i < JOB_QUEUE_SIZE; ++i )
+		return;
+	}
+
+	MixerWorkerThread * self = currentWorker();
+
+	// only wake up as many workers as we have seeded deques for - the
+	// remaining ones stay parked
+	const int numWorkers = workerThreads.size() - 1;
+	const int toWake = qMin( qMax( m_seeded - 1, 0 ), numWorkers );
+
+	m_running = true;
+	m_activeWorkers = toWake;
+	for( int i = 0; i < toWake; ++i )
+	{
+		workerThreads[i]->m_busy = true;
+		workerThreads[i]->m_hasWork = true;
+		workerThreads[i]->m_parker.unpark();
+	}
+
+	while( true )
+	{
+		run( self );
+
+		if( m_pending == 0 && m_activeWorkers == 0 )
+		{
+			break;
+		}
+
+		// remaining jobs are being processed by other threads - spin a
+		// bit before going to sleep as they usually finish soon
+		int spins = 0;
+		while( ( m_pending > 0 || m_activeWorkers > 0 ) &&
+							spins < WAIT_SPIN_ROUNDS )
 		{
-			ThreadableJob * job = m_items[i].exchange(nullptr);
-			if( job )
-			{
-				job->process();
-				processedJob = true;
-				++m_itemsDone;
-			}
+			cpuRelax();
+			++spins;
+		}
+		if( spins >= WAIT_SPIN_ROUNDS )
+		{
+			m_waiter.park();
 		}
-		// always exit loop if we're not in dynamic mode
-		processedJob = processedJob && ( m_opMode == Dynamic );
 	}
+
+	m_running = false;
+	m_seeded = 0;
 }
 
 
 
 
-void MixerWorkerThread::JobQueue::wait()
+void MixerWorkerThread::JobQueue::run( MixerWorkerThread * _self )
 {
-	while (m_itemsDone < m_writeIndex)
+	const int maxIdleRounds = m_opMode == Dynamic ?
+						DYNAMIC_IDLE_ROUNDS : STATIC_IDLE_ROUNDS;
+	int idleRounds = 0;
+
+	while( m_pending > 0 )
 	{
-#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
-		_mm_pause();
-#endif
+		ThreadableJob * job = _self->m_jobs.pop();
+		if( job == nullptr )
+		{
+			job = steal( _self );
+		}
+
+		if( job )
+		{
+			const int64_t start = profiler->timestamp();
+			job->process();
+			profiler->finishJob( job, start );
+			jobDone();
+			idleRounds = 0;
+		}
+		else if( ++idleRounds > maxIdleRounds )
+		{
+			// nothing left to steal - remaining jobs are in progress
+			break;
+		}
+		else
+		{
+			cpuRelax();
+		}
+	}
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::wakeIdleWorker()
+{
+	const int numWorkers = workerThreads.size() - 1;
+	if( m_activeWorkers >= numWorkers )
+	{
+		return;
+	}
+
+	for( int i = 0; i < numWorkers; ++i )
+	{
+		MixerWorkerThread * worker = workerThreads[i];
+		bool busy = false;
+		if( worker->m_busy.compare_exchange_strong( busy, true ) )
+		{
+			// the job which added work is still pending, so the
+			// waiting thread can't finish before we're counted
+			++m_activeWorkers;
+			worker->m_hasWork = true;
+			worker->m_parker.unpark();
+			return;
+		}
+	}
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::workerIdle()
+{
+	if( --m_activeWorkers == 0 )
+	{
+		m_waiter.unpark();
+	}
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::JobQueue::steal( MixerWorkerThread * _self )
+{
+	const int n = workerThreads.size();
+	for( int i = 1; i < n; ++i )
+	{
+		ThreadableJob * job = workerThreads[( _self->m_index + i ) % n]->m_jobs.steal();
+		if( job )
+		{
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+
+
+
+void MixerWorkerThread::JobQueue::jobDone()
+{
+	if( --m_pending == 0 )
+	{
+		m_waiter.unpark();
 	}
 }
 
@@ -109,18 +391,16 @@ void MixerWorkerThread::JobQueue::wait()
 
 MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
 	QThread( mixer ),
+	m_index( workerThreads.size() ),
+	m_hasWork( false ),
+	m_busy( false ),
 	m_quit( false )
 {
-	// initialize global static data
-	if( queueReadyWaitCond == NULL )
-	{
-		queueReadyWaitCond = new QWaitCondition;
-	}
-
 	// keep track of all instantiated worker threads - this is used for
 	// processing the last worker thread "inline", see comments in
 	// MixerWorkerThread::startAndWaitForJobs() for details
 	workerThreads << this;
+	profiler = &mixer->profiler();
 
 	resetJobQueue();
 }
@@ -139,7 +419,7 @@ MixerWorkerThread::~MixerWorkerThread()
 void MixerWorkerThread::quit()
 {
 	m_quit = true;
-	resetJobQueue();
+	m_parker.unpark();
 }
 
 
@@ -147,12 +427,18 @@ void MixerWorkerThread::quit()
 
 void MixerWorkerThread::startAndWaitForJobs()
 {
-	queueReadyWaitCond->wakeAll();
 	// The last worker-thread is never started. Instead it's processed "inline"
 	// i.e. within the global Mixer thread. This way we can reduce latencies
 	// that otherwise would be caused by synchronizing with another thread.
-	globalJobQueue.run();
-	globalJobQueue.wait();
+	globalJobQueue.runAndWait();
+}
+
+
+
+
+MixerWorkerThread * MixerWorkerThread::currentWorker()
+{
+	return s_currentWorker ? s_currentWorker : workerThreads.last();
 }
 
 
@@ -163,13 +449,18 @@ void MixerWorkerThread::run()
 	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
 	disable_denormals();
 
-	QMutex m;
+	s_currentWorker = this;
+	MixerProfiler::setCurrentWorker( m_index );
+
 	while( m_quit == false )
 	{
-		m.lock();
-		queueReadyWaitCond->wait( &m );
-		globalJobQueue.run();
-		m.unlock();
+		m_parker.park();
+		if( m_hasWork.exchange( false ) )
+		{
+			globalJobQueue.run( this );
+			m_busy = false;
+			globalJobQueue.workerIdle();
+		}
 	}
 }
 
@@ -187,6 +187,30 @@ void NotePlayHandle::setPanning( panning_t panning )
 
 
 
+bool NotePlayHandle::sendsEventsThisPeriod() const
+{
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	if( m_muted || offset() >= fpp )
+	{
+		return false;
+	}
+
+	// arpeggios create new sub-notes in any period, chords in the first one
+	if( !hasParent() && ( m_totalFramesPlayed == 0 || m_instrumentTrack->isArpeggioEnabled() ) )
+	{
+		return true;
+	}
+
+	// same condition as in play()
+	const f_cnt_t framesThisPeriod = m_totalFramesPlayed == 0 ? fpp - offset() : fpp;
+	return m_released == false &&
+		m_instrumentTrack->isSustainPedalPressed() == false &&
+		m_totalFramesPlayed + framesThisPeriod > m_frames;
+}
+
+
+
+
 int NotePlayHandle::midiKey() const
 {
 	return key() - m_origBaseNote + instrumentTrack()->baseNote();
@@ -549,25 +573,109 @@ void NotePlayHandle::resize( const bpm_t _new_tempo )
 }
 
 
-NotePlayHandle ** NotePlayHandleManager::s_available;
-QReadWriteLock NotePlayHandleManager::s_mutex;
-std::atomic_int NotePlayHandleManager::s_availableIndex;
-int NotePlayHandleManager::s_size;
+namespace
+{
 
+const uint32_t NoSlot = 0xffffffff;
+const int MaxChunks = 4096;
+const int ThreadCacheSize = 32;
 
-void NotePlayHandleManager::init()
+
+struct NphSlot
+{
+	alignas( NotePlayHandle ) unsigned char storage[sizeof( NotePlayHandle )];
+	std::atomic<uint32_t> next;
+	uint32_t index;
+} ;
+
+
+struct NphCache
+{
+	NphSlot * slots[ThreadCacheSize];
+	int count;
+} ;
+
+
+NphSlot * s_chunks[MaxChunks];
+std::atomic<int> s_chunkCount( 0 );
+
+// head of free list: ABA tag in upper, slot index in lower 32 bits
+std::atomic<uint64_t> s_freeSlots( NoSlot );
+
+thread_local NphCache s_nphCache;
+
+
+
+inline NphSlot * slotAt( uint32_t index )
+{
+	return &s_chunks[index / NPH_CACHE_INCREMENT][index % NPH_CACHE_INCREMENT];
+}
+
+
+void pushFreeSlot( NphSlot * slot )
 {
-	s_available = MM_ALLOC( NotePlayHandle*, INITIAL_NPH_CACHE );
+	uint64_t head = s_freeSlots.load( std::memory_order_relaxed );
+	uint64_t newHead;
+	do
+	{
+		slot->next.store( static_cast<uint32_t>( head ), std::memory_order_relaxed );
+		newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) | slot->index;
+	}
+	while( !s_freeSlots.compare_exchange_weak( head, newHead,
+					std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+
+NphSlot * popFreeSlot()
+{
+	uint64_t head = s_freeSlots.load( std::memory_order_acquire );
+	while( static_cast<uint32_t>( head ) != NoSlot )
+	{
+		NphSlot * slot = slotAt( static_cast<uint32_t>( head ) );
+		const uint64_t newHead = ( ( ( head >> 32 ) + 1 ) << 32 ) |
+						slot->next.load( std::memory_order_relaxed );
+		if( s_freeSlots.compare_exchange_weak( head, newHead,
+					std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			return slot;
+		}
+	}
+	return nullptr;
+}
 
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, INITIAL_NPH_CACHE );
 
-	for( int i=0; i < INITIAL_NPH_CACHE; ++i )
+// adds a chunk of slots to the global free list - returns false if the
+// maximum number of chunks is reached
+bool addChunk()
+{
+	int chunk = s_chunkCount.load( std::memory_order_relaxed );
+	do
+	{
+		if( chunk >= MaxChunks )
+		{
+			return false;
+		}
+	}
+	while( !s_chunkCount.compare_exchange_weak( chunk, chunk + 1, std::memory_order_relaxed ) );
+
+	NphSlot * slots = MM_ALLOC( NphSlot, NPH_CACHE_INCREMENT );
+	s_chunks[chunk] = slots;
+	for( int i = 0; i < NPH_CACHE_INCREMENT; ++i )
 	{
-		s_available[ i ] = n;
-		++n;
+		slots[i].index = chunk * NPH_CACHE_INCREMENT + i;
+		pushFreeSlot( &slots[i] );
 	}
-	s_availableIndex = INITIAL_NPH_CACHE - 1;
-	s_size = INITIAL_NPH_CACHE;
+	return true;
+}
+
+}
+
+
+
+
+void NotePlayHandleManager::init()
+{
+	extend( INITIAL_NPH_CACHE );
 }
 
 
@@ -579,42 +687,72 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 				int midiEventChannel,
 				NotePlayHandle::Origin origin )
 {
-	if( s_availableIndex < 0 )
+	NphCache & cache = s_nphCache;
+
+	NphSlot * slot = nullptr;
+	if( cache.count > 0 )
 	{
-		s_mutex.lockForWrite();
-		if( s_availableIndex < 0 ) extend( NPH_CACHE_INCREMENT );
-		s_mutex.unlock();
+		slot = cache.slots[--cache.count];
+	}
+	else
+	{
+		// take a batch so we don't hit the global free list every time
+		while( ( slot = popFreeSlot() ) == nullptr )
+		{
+			if( !addChunk() )
+			{
+				// pool is at its limit - fall back to a separate slot
+				slot = MM_ALLOC( NphSlot, 1 );
+				slot->index = NoSlot;
+				break;
+			}
+		}
+		while( cache.count < ThreadCacheSize / 2 )
+		{
+			NphSlot * cached = popFreeSlot();
+			if( cached == nullptr )
+			{
+				break;
+			}
+			cache.slots[cache.count++] = cached;
+		}
 	}
-	s_mutex.lockForRead();
-	NotePlayHandle * nph = s_available[s_availableIndex--];
-	s_mutex.unlock();
 
-	new( (void*)nph ) NotePlayHandle( instrumentTrack, offset, frames, noteToPlay, parent, midiEventChannel, origin );
-	return nph;
+	return new( (void*)slot->storage ) NotePlayHandle( instrumentTrack, offset, frames, noteToPlay, parent, midiEventChannel, origin );
 }
 
 
 void NotePlayHandleManager::release( NotePlayHandle * nph )
 {
 	nph->NotePlayHandle::~NotePlayHandle();
-	s_mutex.lockForRead();
-	s_available[++s_availableIndex] = nph;
-	s_mutex.unlock();
+
+	NphSlot * slot = reinterpret_cast<NphSlot *>( nph );
+	if( slot->index == NoSlot )
+	{
+		MM_FREE( slot );
+		return;
+	}
+
+	NphCache & cache = s_nphCache;
+	if( cache.count == ThreadCacheSize )
+	{
+		// hand half of our slots back to other threads
+		while( cache.count > ThreadCacheSize / 2 )
+		{
+			pushFreeSlot( cache.slots[--cache.count] );
+		}
+	}
+	cache.slots[cache.count++] = slot;
 }
 
 
 void NotePlayHandleManager::extend( int c )
 {
-	s_size += c;
-	NotePlayHandle ** tmp = MM_ALLOC( NotePlayHandle*, s_size );
-	MM_FREE( s_available );
-	s_available = tmp;
-
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, c );
-
-	for( int i=0; i < c; ++i )
+	for( int i = 0; i < c; i += NPH_CACHE_INCREMENT )
 	{
-		s_available[++s_availableIndex] = n;
-		++n;
+		if( !addChunk() )
+		{
+			break;
+		}
 	}
 }
@@ -0,0 +1,425 @@
+/*
+ * ParallelRenderer.cpp - renders sections of a song in separate processes and
+ *                        stitches them together
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "ParallelRenderer.h"
+
+#include <cmath>
+#include <memory>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "AudioFileDevice.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "Song.h"
+
+
+// length of the crossfade between two sections
+static const int CROSSFADE_MS = 20;
+
+// renders where the overlapping parts of two sections differ by more than
+// this fail
+static const float MISMATCH_THRESHOLD_DB = -20.0f;
+
+
+ParallelRenderer::ParallelRenderer( const QString & projectFile,
+					const QStringList & renderArgs,
+					const OutputSettings & outputSettings,
+					ProjectRenderer::ExportFileFormats format,
+					const QString & outputPath,
+					int sections, int prerollTacts,
+					QObject * parent ) :
+	QObject( parent ),
+	m_projectFile( projectFile ),
+	m_renderArgs( renderArgs ),
+	m_outputSettings( outputSettings ),
+	m_format( format ),
+	m_outputPath( outputPath ),
+	m_numSections( sections ),
+	m_prerollTacts( prerollTacts ),
+	m_tempDir(),
+	m_sections(),
+	m_sectionsDone( 0 ),
+	m_aborted( false ),
+	m_overlap( outputSettings.getSampleRate() * CROSSFADE_MS / 1000 ),
+	m_readBuffer()
+{
+}
+
+
+
+
+ParallelRenderer::~ParallelRenderer()
+{
+	for( Section & section : m_sections )
+	{
+		if( section.process->state() != QProcess::NotRunning )
+		{
+			section.process->kill();
+			section.process->waitForFinished();
+		}
+	}
+}
+
+
+
+
+void ParallelRenderer::start()
+{
+	if( !m_tempDir.isValid() )
+	{
+		abort( "Could not create a directory for the sections" );
+		return;
+	}
+
+	// the mixer of this process has nothing to do but keep a core busy
+	Engine::mixer()->stopProcessing();
+
+	const std::pair<MidiTime, MidiTime> endpoints =
+				Engine::getSong()->getExportEndpoints();
+	const tick_t begin = endpoints.first.getTicks();
+	const tick_t end = endpoints.second.getTicks();
+	const tick_t ticksPerTact = MidiTime::ticksPerTact();
+
+	// split at tact boundaries, at least one tact per section
+	const int tacts = qMax<int>( ( end - begin + ticksPerTact - 1 ) /
+							ticksPerTact, 1 );
+	const int numSections = qBound( 1, m_numSections, tacts );
+
+	// share the threads this process would have rendered with, otherwise
+	// every process starts one per core
+	const int threads = qMax( 1, Engine::mixer()->threadCount() / numSections );
+
+	for( int i = 0; i < numSections; ++i )
+	{
+		Section section;
+		section.range.begin = begin + tacts * i / numSections * ticksPerTact;
+		section.range.end = i + 1 == numSections ? end :
+			begin + tacts * ( i + 1 ) / numSections * ticksPerTact;
+		section.range.preroll = i == 0 ? 0 : m_prerollTacts * ticksPerTact;
+		section.range.overlap = i + 1 == numSections ? 0 : m_overlap;
+		section.path = QDir( m_tempDir.path() ).filePath(
+					QString( "section%1.wav" ).arg( i ) );
+
+		section.process = new QProcess( this );
+		section.process->setProperty( "section", i );
+		// their progress bars would only get in the way of ours
+		section.process->setStandardOutputFile( QProcess::nullDevice() );
+		section.process->setStandardErrorFile( QProcess::nullDevice() );
+		connect( section.process, SIGNAL( finished( int, QProcess::ExitStatus ) ),
+			this, SLOT( sectionFinished( int, QProcess::ExitStatus ) ) );
+		connect( section.process, SIGNAL( errorOccurred( QProcess::ProcessError ) ),
+			this, SLOT( sectionFailed( QProcess::ProcessError ) ) );
+
+		m_sections.push_back( section );
+	}
+
+	for( Section & section : m_sections )
+	{
+		QStringList args = m_renderArgs;
+		args << "--render" << m_projectFile
+			<< "--output" << section.path
+			<< "--format" << "wav"
+			<< "--float"
+			<< "--threads" << QString::number( threads )
+			<< "--section" << QString( "%1:%2:%3:%4" ).
+						arg( section.range.begin ).
+						arg( section.range.end ).
+						arg( section.range.preroll ).
+						arg( section.range.overlap );
+		section.process->start( QCoreApplication::applicationFilePath(), args );
+	}
+}
+
+
+
+
+void ParallelRenderer::updateConsoleProgress()
+{
+	fprintf( stderr, "\rRendered %d of %d sections   ",
+				m_sectionsDone, (int) m_sections.size() );
+	fflush( stderr );
+}
+
+
+
+
+void ParallelRenderer::sectionFinished( int exitCode,
+					QProcess::ExitStatus exitStatus )
+{
+	const int i = sender()->property( "section" ).toInt();
+	if( exitStatus != QProcess::NormalExit || exitCode != EXIT_SUCCESS )
+	{
+		abort( QString( "Rendering section %1 failed" ).arg( i + 1 ) );
+		return;
+	}
+
+	if( ++m_sectionsDone < (int) m_sections.size() || m_aborted )
+	{
+		return;
+	}
+
+	updateConsoleProgress();
+	fprintf( stderr, "\n" );
+
+	if( stitch() )
+	{
+		emit finished( EXIT_SUCCESS );
+	}
+	else
+	{
+		QFile( m_outputPath ).remove();
+		emit finished( EXIT_FAILURE );
+	}
+}
+
+
+
+
+void ParallelRenderer::sectionFailed( QProcess::ProcessError error )
+{
+	// crashes are reported through sectionFinished()
+	if( error == QProcess::FailedToStart )
+	{
+		const int i = sender()->property( "section" ).toInt();
+		abort( QString( "Could not start a process for section %1" ).
+								arg( i + 1 ) );
+	}
+}
+
+
+
+
+void ParallelRenderer::abort( const QString & message )
+{
+	if( m_aborted )
+	{
+		return;
+	}
+	m_aborted = true;
+
+	fprintf( stderr, "\n%s\n", message.toUtf8().constData() );
+	for( Section & section : m_sections )
+	{
+		section.process->kill();
+	}
+	emit finished( EXIT_FAILURE );
+}
+
+
+
+
+bool ParallelRenderer::stitch()
+{
+	AudioFileDeviceInstantiaton audioEncoderFactory =
+		ProjectRenderer::fileEncodeDevices[m_format].m_getDevInst;
+	if( !audioEncoderFactory )
+	{
+		fprintf( stderr, "The output format is not available\n" );
+		return false;
+	}
+
+	bool successful = false;
+	std::unique_ptr<AudioFileDevice> device( audioEncoderFactory(
+				m_outputPath, m_outputSettings, DEFAULT_CHANNELS,
+					Engine::mixer(), successful ) );
+	if( !successful )
+	{
+		return false;
+	}
+
+	const f_cnt_t blockFrames = AudioFileDevice::MaxRenderedFrames;
+	std::unique_ptr<surroundSampleFrame[]> block(
+					new surroundSampleFrame[blockFrames] );
+	// overlap of the previous section and the beginning of the current one,
+	// which gets one more frame as the sections may be a frame apart
+	std::unique_ptr<surroundSampleFrame[]> tail(
+					new surroundSampleFrame[m_overlap] );
+	std::unique_ptr<surroundSampleFrame[]> head(
+					new surroundSampleFrame[m_overlap + 1] );
+	f_cnt_t tailFrames = 0;
+
+	for( size_t i = 0; i < m_sections.size(); ++i )
+	{
+		const Section & section = m_sections[i];
+
+		SF_INFO info;
+		memset( &info, 0, sizeof( info ) );
+		SNDFILE * file = sf_open( section.path.toLocal8Bit().constData(),
+							SFM_READ, &info );
+		if( !file )
+		{
+			fprintf( stderr, "Could not read section %d: %s\n",
+						(int) i + 1, sf_strerror( NULL ) );
+			return false;
+		}
+		f_cnt_t framesLeft = info.frames;
+
+		if( tailFrames > 0 )
+		{
+			const f_cnt_t headFrames = readFrames( file, info.channels,
+				head.get(), qMin<f_cnt_t>( tailFrames + 1, framesLeft ) );
+			framesLeft -= headFrames;
+			const f_cnt_t frames = qMin( tailFrames, headFrames );
+
+			int shift = 0;
+			const float mismatch = compareOverlap( tail.get(),
+						head.get(), frames, shift );
+			if( mismatch > MISMATCH_THRESHOLD_DB )
+			{
+				fprintf( stderr, "Sections %d and %d differ by %.1f dB "
+					"where they overlap - some sound lasts longer than "
+					"the preroll of %d tacts, try a longer --preroll\n",
+					(int) i, (int) i + 1, mismatch, m_prerollTacts );
+				sf_close( file );
+				return false;
+			}
+
+			// stay on the timeline of the previous section, so that no
+			// frame gets dropped or repeated where they meet
+			for( f_cnt_t f = 0; f < tailFrames; ++f )
+			{
+				const float fade = ( f + 0.5f ) / tailFrames;
+				const f_cnt_t h = qBound<f_cnt_t>( 0, f + shift, headFrames - 1 );
+				for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+				{
+					block[f][ch] = tail[f][ch] * ( 1.0f - fade ) +
+							head[h][ch] * fade;
+				}
+			}
+			device->writeFileRateBuffer( block.get(), tailFrames );
+
+			// frames read ahead which come after the crossfade
+			const f_cnt_t used = qMax<f_cnt_t>( tailFrames + shift, 0 );
+			if( used < headFrames )
+			{
+				device->writeFileRateBuffer( head.get() + used,
+							headFrames - used );
+			}
+		}
+
+		// everything up to the overlap with the next section
+		const f_cnt_t overlap = qMin( section.range.overlap, framesLeft );
+		f_cnt_t bodyLeft = framesLeft - overlap;
+		while( bodyLeft > 0 )
+		{
+			const f_cnt_t frames = readFrames( file, info.channels,
+				block.get(), qMin( blockFrames, bodyLeft ) );
+			if( frames == 0 )
+			{
+				break;
+			}
+			device->writeFileRateBuffer( block.get(), frames );
+			bodyLeft -= frames;
+		}
+		tailFrames = readFrames( file, info.channels, tail.get(), overlap );
+
+		sf_close( file );
+		QFile( section.path ).remove();
+	}
+
+	return true;
+}
+
+
+
+
+f_cnt_t ParallelRenderer::readFrames( SNDFILE * file, int channels,
+				surroundSampleFrame * dst, f_cnt_t frames )
+{
+	m_readBuffer.resize( AudioFileDevice::MaxRenderedFrames * channels );
+
+	f_cnt_t done = 0;
+	while( done < frames )
+	{
+		const f_cnt_t chunk = qMin<f_cnt_t>( frames - done,
+					AudioFileDevice::MaxRenderedFrames );
+		const f_cnt_t read = sf_readf_float( file, m_readBuffer.data(), chunk );
+		for( f_cnt_t f = 0; f < read; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+			{
+				dst[done + f][ch] = m_readBuffer[f * channels +
+							ch % channels];
+			}
+		}
+		done += read;
+		if( read < chunk )
+		{
+			break;
+		}
+	}
+	return done;
+}
+
+
+
+
+// How much two renders of the same frames differ in dB relative to their
+// level - the renders may be a frame apart, as sections start on whole
+// frames, so the best of the neighbouring alignments counts. shift is set
+// to the alignment, i.e. a[f] matches b[f + shift].
+float ParallelRenderer::compareOverlap( const surroundSampleFrame * a,
+				const surroundSampleFrame * b, f_cnt_t frames,
+				int & shift )
+{
+	shift = 0;
+
+	double level = 0;
+	for( f_cnt_t f = 0; f < frames; ++f )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			level += a[f][ch] * a[f][ch] + b[f][ch] * b[f][ch];
+		}
+	}
+	// don't bother about silence
+	if( level < frames * 1e-8 )
+	{
+		return -INFINITY;
+	}
+
+	double best = level;
+	// try no shift first, so it wins a tie
+	for( int s : { 0, -1, 1 } )
+	{
+		double difference = 0;
+		for( f_cnt_t f = 1; f < frames - 1; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+			{
+				const float d = a[f][ch] - b[f + s][ch];
+				difference += d * d;
+			}
+		}
+		if( difference < best )
+		{
+			best = difference;
+			shift = s;
+		}
+	}
+
+	return 10.0f * log10f( best / level + 1e-12 );
+}
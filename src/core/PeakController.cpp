@@ -70,6 +70,20 @@ PeakController::~PeakController()
 }
 
 
+void PeakController::addDependencies()
+{
+	// the peak itself is taken from the previous period, only the
+	// coefficients may be controlled
+	if( m_peakEffect )
+	{
+		dependsOn( m_peakEffect->attackModel() );
+		dependsOn( m_peakEffect->decayModel() );
+	}
+}
+
+
+
+
 void PeakController::updateValueBuffer()
 {
 	if( m_coeffNeedsUpdate )
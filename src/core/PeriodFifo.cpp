@@ -0,0 +1,158 @@
+/*
+ * PeriodFifo.cpp - ring of preallocated period buffers between the mixer's
+ *                  fifo writer and the audio device
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "PeriodFifo.h"
+
+#include <chrono>
+
+#include "MemoryHelper.h"
+
+
+// number of spins the reader does before going to sleep - an underrun
+// usually means the writer is about to finish a period
+static const int READER_SPIN_ROUNDS = 1024;
+
+
+PeriodFifo::PeriodFifo( int depth, fpp_t framesPerPeriod ) :
+	m_depth( qMax( depth, 1 ) ),
+	m_numSlots( m_depth + 1 ),
+	m_framesPerPeriod( framesPerPeriod ),
+	m_slots( new Slot[m_numSlots] ),
+	m_written( 0 ),
+	m_released( 0 ),
+	m_read( 0 ),
+	m_holding( false ),
+	m_underruns( 0 ),
+	m_writerWaits( 0 ),
+	m_latency()
+{
+	for( int i = 0; i < m_numSlots; ++i )
+	{
+		m_slots[i].buffer = (surroundSampleFrame *)
+			MemoryHelper::alignedMalloc( m_framesPerPeriod *
+						sizeof( surroundSampleFrame ) );
+		m_slots[i].queued = 0;
+		m_slots[i].endOfStream = false;
+	}
+}
+
+
+
+
+PeriodFifo::~PeriodFifo()
+{
+	for( int i = 0; i < m_numSlots; ++i )
+	{
+		MemoryHelper::alignedFree( m_slots[i].buffer );
+	}
+	delete[] m_slots;
+}
+
+
+
+
+surroundSampleFrame * PeriodFifo::beginWrite()
+{
+	const int64_t written = m_written.load( std::memory_order_relaxed );
+	if( written - m_released.load( std::memory_order_acquire ) >= m_numSlots )
+	{
+		m_writerWaits.fetch_add( 1, std::memory_order_relaxed );
+		while( written - m_released.load( std::memory_order_acquire ) >= m_numSlots )
+		{
+			m_writerParker.park();
+		}
+	}
+	return m_slots[written % m_numSlots].buffer;
+}
+
+
+
+
+void PeriodFifo::endWrite( bool endOfStream )
+{
+	const int64_t written = m_written.load( std::memory_order_relaxed );
+	Slot & slot = m_slots[written % m_numSlots];
+	slot.queued = now();
+	slot.endOfStream = endOfStream;
+	m_written.store( written + 1, std::memory_order_release );
+	m_readerParker.unpark();
+}
+
+
+
+
+const surroundSampleFrame * PeriodFifo::read()
+{
+	// hand back the buffer we returned last time
+	if( m_holding )
+	{
+		m_released.store( m_read, std::memory_order_release );
+		m_holding = false;
+		m_writerParker.unpark();
+	}
+
+	if( m_written.load( std::memory_order_acquire ) <= m_read )
+	{
+		m_underruns.fetch_add( 1, std::memory_order_relaxed );
+		int spins = 0;
+		while( m_written.load( std::memory_order_acquire ) <= m_read )
+		{
+			if( ++spins > READER_SPIN_ROUNDS )
+			{
+				m_readerParker.park();
+			}
+		}
+	}
+
+	const Slot & slot = m_slots[m_read % m_numSlots];
+	++m_read;
+	m_holding = true;
+
+	m_latency.add( now() - slot.queued );
+
+	return slot.endOfStream ? NULL : slot.buffer;
+}
+
+
+
+
+PeriodFifo::Statistics PeriodFifo::statistics() const
+{
+	Statistics s;
+	s.depth = m_depth;
+	// approximated, as the reader's position isn't shared
+	s.fillLevel = qBound<int>( 0, m_written.load( std::memory_order_relaxed ) -
+				m_released.load( std::memory_order_relaxed ) - 1, m_depth );
+	s.underruns = m_underruns.load( std::memory_order_relaxed );
+	s.writerWaits = m_writerWaits.load( std::memory_order_relaxed );
+	return s;
+}
+
+
+
+
+int64_t PeriodFifo::now() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
@@ -23,6 +23,7 @@
  */
  
 #include "PlayHandle.h"
+#include "AudioPort.h"
 #include "BufferManager.h"
 #include "Engine.h"
 #include "Mixer.h"
@@ -38,7 +39,8 @@ PlayHandle::PlayHandle(const Type type, f_cnt_t offset) :
 		m_affinity(QThread::currentThread()),
 		m_playHandleBuffer(BufferManager::acquire()),
 		m_bufferReleased(true),
-		m_usesBuffer(true)
+		m_usesBuffer(true),
+		m_audioPort(nullptr)
 {
 }
 
@@ -61,6 +63,17 @@ void PlayHandle::doProcessing()
 	{
 		play( NULL );
 	}
+
+	if( m_audioPort )
+	{
+		m_audioPort->playHandleDone();
+	}
+}
+
+
+QString PlayHandle::jobName() const
+{
+	return m_audioPort ? m_audioPort->name() : QString( "Play handle" );
 }
 
 
@@ -29,6 +29,7 @@
 #include "Song.h"
 #include "PerfLog.h"
 
+#include "AudioFileEncoder.h"
 #include "AudioFileWave.h"
 #include "AudioFileOgg.h"
 #include "AudioFileMP3.h"
@@ -83,6 +84,9 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 					const QString & outputFilename ) :
 	QThread( Engine::mixer() ),
 	m_fileDev( NULL ),
+	m_stemExporter( NULL ),
+	m_section(),
+	m_renderSection( false ),
 	m_qualitySettings( qualitySettings ),
 	m_progress( 0 ),
 	m_abort( false )
@@ -164,6 +168,17 @@ void ProjectRenderer::startProcessing()
 }
 
 
+// Number of frames rendered since the given tick has been reached, negative
+// if it has not been reached yet
+static f_cnt_t framesSince( const Song::PlayPos & pos, tick_t tick )
+{
+	return static_cast<f_cnt_t>( ( pos.getTicks() - tick ) *
+				Engine::framesPerTick() + pos.currentFrame() + 0.5f );
+}
+
+
+
+
 void ProjectRenderer::run()
 {
 	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
@@ -180,11 +195,25 @@ void ProjectRenderer::run()
 
 	PerfLogTimer perfLog("Project Render");
 
+	if( m_renderSection )
+	{
+		Engine::getSong()->setExportRange(
+			qMax( m_section.begin - m_section.preroll, 0 ),
+							m_section.end );
+	}
+
 	Engine::getSong()->startExport();
 	Engine::getSong()->updateLength();
 	// Skip first empty buffer.
 	Engine::mixer()->nextBuffer();
 
+	// stems start along with the file
+	Engine::mixer()->setStemExporter( m_stemExporter );
+
+	// encode on a separate thread so that it doesn't hold up mixing
+	AudioFileEncoder encoder( m_fileDev, Engine::mixer()->framesPerPeriod() );
+	encoder.start();
+
 	const Song::PlayPos & exportPos = Engine::getSong()->getPlayPos(
 							Song::Mode_PlaySong );
 	m_progress = 0;
@@ -193,12 +222,36 @@ void ProjectRenderer::run()
 	tick_t endTick = exportEndpoints.second.getTicks();
 	tick_t lengthTicks = endTick - startTick;
 
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	// processing rate is a multiple of the file's rate
+	f_cnt_t overlapLeft = m_renderSection ? m_section.overlap *
+			( Engine::mixer()->processingSampleRate() /
+					m_fileDev->sampleRate() ) : 0;
+
 	// Continually track and emit progress percentage to listeners.
-	while( exportPos.getTicks() < endTick &&
+	while( ( exportPos.getTicks() < endTick || overlapLeft > 0 ) &&
 				Engine::getSong()->isExporting() == true
 							&& !m_abort )
 	{
-		m_fileDev->processNextBuffer();
+		const surroundSampleFrame * buffer = Engine::mixer()->nextBuffer();
+		fpp_t first = 0;
+		fpp_t last = fpp;
+		if( m_renderSection )
+		{
+			// drop what has been rendered ahead of the section and
+			// what goes beyond its overlap
+			first = fpp - qBound<f_cnt_t>( 0,
+				framesSince( exportPos, m_section.begin ), fpp );
+			const f_cnt_t pastEnd = qBound<f_cnt_t>( 0,
+				framesSince( exportPos, m_section.end ), fpp );
+			last = fpp - qMax<f_cnt_t>( pastEnd - overlapLeft, 0 );
+			overlapLeft -= qMin( pastEnd, overlapLeft );
+		}
+		if( last > first )
+		{
+			encoder.write( buffer + first, last - first,
+					Engine::mixer()->masterGain() );
+		}
 		const int nprog = lengthTicks == 0 ? 100 : (exportPos.getTicks()-startTick) * 100 / lengthTicks;
 		if( m_progress != nprog )
 		{
@@ -207,6 +260,10 @@ void ProjectRenderer::run()
 		}
 	}
 
+	Engine::mixer()->setStemExporter( NULL );
+
+	encoder.finish();
+
 	// Notify mixer of the end of processing.
 	Engine::mixer()->stopProcessing();
 
@@ -36,7 +36,9 @@
 #include <QDebug>
 #include <QDir>
 
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+#include <new>
+#elif !defined(SYNC_WITH_SHM_FIFO)
 #include <QtCore/QUuid>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -91,9 +93,35 @@ RemotePlugin::RemotePlugin() :
 	m_shmSize( 0 ),
 	m_shm( NULL ),
 	m_inputCount( DEFAULT_CHANNELS ),
-	m_outputCount( DEFAULT_CHANNELS )
+	m_outputCount( DEFAULT_CHANNELS ),
+	m_processing( false ),
+	m_processingDone( false ),
+	m_processingTimer(),
+	m_latency()
+#ifdef SYNC_WITH_SHM_RING
+	, m_ringsID( -1 ),
+	m_rings( NULL )
+#endif
 {
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+	m_ringsID = shmget( IPC_PRIVATE, sizeof( shmRing::shmPair ), IPC_CREAT | 0600 );
+	if( m_ringsID == -1 ||
+		( m_rings = (shmRing::shmPair *) shmat( m_ringsID, 0, 0 ) ) ==
+						(shmRing::shmPair *)( -1 ) )
+	{
+		qWarning( "Unable to create shared memory for messages." );
+		m_rings = NULL;
+	}
+	else
+	{
+		new( m_rings ) shmRing::shmPair();
+		// Linux still lets the plugin attach, but the segment is
+		// freed as soon as both processes are gone - even if they crash
+		shmctl( m_ringsID, IPC_RMID, NULL );
+		m_in.attach( &m_rings->toHost );
+		m_out.attach( &m_rings->toClient );
+	}
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	struct sockaddr_un sa;
 	sa.sun_family = AF_LOCAL;
 
@@ -136,6 +164,11 @@ RemotePlugin::~RemotePlugin()
 	m_watcher.quit();
 	m_watcher.wait();
 
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->profiler().removeLatencyHistogram( &m_latency );
+	}
+
 	if( m_failed == false )
 	{
 		if( isRunning() )
@@ -158,7 +191,14 @@ RemotePlugin::~RemotePlugin()
 #endif
 	}
 
-#ifndef SYNC_WITH_SHM_FIFO
+#ifdef SYNC_WITH_SHM_RING
+	m_in.attach( NULL );
+	m_out.attach( NULL );
+	if( m_rings != NULL )
+	{
+		shmdt( m_rings );
+	}
+#elif !defined(SYNC_WITH_SHM_FIFO)
 	if ( close( m_server ) == -1)
 	{
 		qWarning( "Error freeing resources." );
@@ -207,11 +247,19 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 		return failed();
 	}
 
+	// a restarted plugin is listed as a new instance
+	Engine::mixer()->profiler().removeLatencyHistogram( &m_latency );
+	m_latency.reset();
+	Engine::mixer()->profiler().addLatencyHistogram(
+			QFileInfo( pluginExecutable ).baseName(), &m_latency );
+
 	QStringList args;
 #ifdef SYNC_WITH_SHM_FIFO
 	// swap in and out for bidirectional communication
 	args << QString::number( out()->shmKey() );
 	args << QString::number( in()->shmKey() );
+#elif defined(SYNC_WITH_SHM_RING)
+	args << QString::number( m_ringsID );
 #else
 	args << m_socketFile;
 #endif
@@ -225,7 +273,7 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 	qDebug() << exec << args;
 #endif
 
-#ifndef SYNC_WITH_SHM_FIFO
+#if !defined(SYNC_WITH_SHM_FIFO) && !defined(SYNC_WITH_SHM_RING)
 	struct pollfd pollin;
 	pollin.fd = m_server;
 	pollin.events = POLLIN;
@@ -265,15 +313,29 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 
 bool RemotePlugin::process( const sampleFrame * _in_buf,
 						sampleFrame * _out_buf )
+{
+	if( !m_processing )
+	{
+		startProcessing( _in_buf );
+	}
+	return finishProcessing( _out_buf );
+}
+
+
+
+
+bool RemotePlugin::startProcessing( const sampleFrame * _in_buf )
 {
 	const fpp_t frames = Engine::mixer()->framesPerPeriod();
 
+	if( m_processing )
+	{
+		// the output of the last period was never fetched
+		finishProcessing( NULL );
+	}
+
 	if( m_failed || !isRunning() )
 	{
-		if( _out_buf != NULL )
-		{
-			BufferManager::clear( _out_buf, frames );
-		}
 		return false;
 	}
 
@@ -289,18 +351,20 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			fetchAndProcessAllMessages();
 			unlock();
 		}
-		if( _out_buf != NULL )
-		{
-			BufferManager::clear( _out_buf, frames );
-		}
 		return false;
 	}
 
-	memset( m_shm, 0, m_shmSize );
+	ch_cnt_t inputs = _in_buf != NULL ?
+			qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS ) : 0;
 
-	ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
+	// inputs are written in place below, so only clear what isn't - the
+	// plugin may leave the outputs untouched if it is busy
+	const ch_cnt_t written = m_splitChannels ||
+			inputs == DEFAULT_CHANNELS ? inputs : 0;
+	memset( m_shm + written * frames, 0,
+			m_shmSize - written * frames * sizeof( float ) );
 
-	if( _in_buf != NULL && inputs > 0 )
+	if( inputs > 0 )
 	{
 		if( m_splitChannels )
 		{
@@ -331,17 +395,54 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 	}
 
 	lock();
+	m_processingDone = false;
+	m_processingTimer.reset();
 	sendMessage( IdStartProcessing );
+	m_processing = !m_failed;
+	unlock();
+
+	return m_processing;
+}
+
+
 
-	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
+
+bool RemotePlugin::finishProcessing( sampleFrame * _out_buf )
+{
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+
+	if( !m_processing )
 	{
-		unlock();
+		if( _out_buf != NULL )
+		{
+			BufferManager::clear( _out_buf, frames );
+		}
 		return false;
 	}
+	m_processing = false;
 
-	waitForMessage( IdProcessingDone );
+	lock();
+	// the reply might have been fetched by another thread waiting for
+	// a message already
+	if( !m_processingDone )
+	{
+		waitForMessage( IdProcessingDone );
+	}
 	unlock();
 
+	m_latency.add( m_processingTimer.elapsed() );
+
+	if( _out_buf == NULL )
+	{
+		return false;
+	}
+
+	if( m_failed || m_outputCount == 0 )
+	{
+		BufferManager::clear( _out_buf, frames );
+		return false;
+	}
+
 	const ch_cnt_t outputs = qMin<ch_cnt_t>( m_outputCount,
 							DEFAULT_CHANNELS );
 	if( m_splitChannels )
@@ -525,6 +626,9 @@ bool RemotePlugin::processMessage( const message & _m )
 			break;
 
 		case IdProcessingDone:
+			m_processingDone = true;
+			break;
+
 		case IdQuit:
 		default:
 			break;
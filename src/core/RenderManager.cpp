@@ -29,6 +29,10 @@
 #include "Song.h"
 #include "BBTrackContainer.h"
 #include "BBTrack.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "SampleTrack.h"
+#include "StemExporter.h"
 #include "stdshims.h"
 
 
@@ -41,7 +45,9 @@ RenderManager::RenderManager(
 	m_oldQualitySettings( Engine::mixer()->currentQualitySettings() ),
 	m_outputSettings(outputSettings),
 	m_format(fmt),
-	m_outputPath(outputPath)
+	m_outputPath(outputPath),
+	m_section(),
+	m_renderSection( false )
 {
 	Engine::mixer()->storeAudioDevice();
 }
@@ -52,49 +58,36 @@ RenderManager::~RenderManager()
 	Engine::mixer()->changeQuality( m_oldQualitySettings );
 }
 
+void RenderManager::setSection( const ProjectRenderer::Section & section )
+{
+	m_section = section;
+	m_renderSection = true;
+}
+
 void RenderManager::abortProcessing()
 {
 	if ( m_activeRenderer ) {
 		disconnect( m_activeRenderer.get(), SIGNAL( finished() ),
-				this, SLOT( renderNextTrack() ) );
+				this, SLOT( renderFinished() ) );
 		m_activeRenderer->abortProcessing();
 	}
-	restoreMutedState();
+	finishStems( true );
 }
 
-// Called to render each new track when rendering tracks individually.
-void RenderManager::renderNextTrack()
+// Called when the renderer is done
+void RenderManager::renderFinished()
 {
 	m_activeRenderer.reset();
-
-	if( m_tracksToRender.isEmpty() )
-	{
-		// nothing left to render
-		restoreMutedState();
-		emit finished();
-	}
-	else
-	{
-		// pop the next track from our rendering queue
-		Track* renderTrack = m_tracksToRender.back();
-		m_tracksToRender.pop_back();
-
-		// mute everything but the track we are about to render
-		for( auto it = m_unmuted.begin(); it != m_unmuted.end(); ++it )
-		{
-			(*it)->setMuted( (*it) != renderTrack );
-		}
-
-		// for multi-render, prefix each output file with a different number
-		int trackNum = m_tracksToRender.size() + 1;
-
-		render( pathForTrack(renderTrack, trackNum) );
-	}
+	finishStems( false );
+	emit finished();
 }
 
-// Render the song into individual tracks
-void RenderManager::renderTracks()
+// Render the song once and write the output of each track (and each FX
+// channel if requested) into individual files along with the master mix
+void RenderManager::renderTracks( bool includeFxChannels )
 {
+	QVector<Track*> tracks;
+
 	const TrackContainer::TrackList & tl = Engine::getSong()->tracks();
 
 	// find all currently unnmuted tracks -- we want to render these.
@@ -103,11 +96,11 @@ void RenderManager::renderTracks()
 		Track* tk = (*it);
 		Track::TrackTypes type = tk->type();
 
-		// Don't mute automation tracks
+		// Automation tracks don't have any output
 		if ( tk->isMuted() == false &&
 				( type == Track::InstrumentTrack || type == Track::SampleTrack ) )
 		{
-			m_unmuted.push_back(tk);
+			tracks.push_back(tk);
 		}
 	}
 
@@ -117,15 +110,40 @@ void RenderManager::renderTracks()
 		Track* tk = (*it);
 		if ( tk->isMuted() == false )
 		{
-			m_unmuted.push_back(tk);
+			tracks.push_back(tk);
 		}
 	}
 
-	// copy the list of unmuted tracks into our rendering queue.
-	// we need to remember which tracks were unmuted to restore state at the end.
-	m_tracksToRender = m_unmuted;
+	m_stemExporter = make_unique<StemExporter>();
+
+	for( int i = 0; i < tracks.size(); ++i )
+	{
+		AudioPort * port = audioPortOf( tracks[i] );
+		AudioFileDevice * device = port ?
+				createFileDevice( pathForTrack( tracks[i], i + 1 ) ) : NULL;
+		if( device )
+		{
+			m_stemExporter->addStem( port, device );
+		}
+	}
 
-	renderNextTrack();
+	if( includeFxChannels )
+	{
+		FxMixer * fxMixer = Engine::fxMixer();
+		for( int i = 1; i < fxMixer->numChannels(); ++i )
+		{
+			FxChannel * channel = fxMixer->effectChannel( i );
+			AudioFileDevice * device = createFileDevice(
+					pathForFxChannel( channel, i ) );
+			if( device )
+			{
+				m_stemExporter->addStem( channel, device );
+			}
+		}
+	}
+
+	QString extension = ProjectRenderer::getFileExtensionFromFormat( m_format );
+	render( QDir(m_outputPath).filePath( "0_Master" + extension ) );
 }
 
 // Render the song into a single track
@@ -148,28 +166,69 @@ void RenderManager::render(QString outputPath)
 		connect( m_activeRenderer.get(), SIGNAL( progressChanged( int ) ),
 				this, SIGNAL( progressChanged( int ) ) );
 
-		// when it is finished, render the next track.
-		// if we have not queued any tracks, renderNextTrack will just clean up
 		connect( m_activeRenderer.get(), SIGNAL( finished() ),
-				this, SLOT( renderNextTrack() ) );
+				this, SLOT( renderFinished() ) );
+
+		if( m_renderSection )
+		{
+			m_activeRenderer->setSection( m_section );
+		}
+
+		if( m_stemExporter )
+		{
+			m_stemExporter->start();
+			m_activeRenderer->setStemExporter( m_stemExporter.get() );
+		}
 
 		m_activeRenderer->startProcessing();
 	}
 	else
 	{
 		qDebug( "Renderer failed to acquire a file device!" );
-		renderNextTrack();
+		renderFinished();
 	}
 }
 
-// Unmute all tracks that were muted while rendering tracks
-void RenderManager::restoreMutedState()
+// Wait for the stems to be written and detach them from the mixer
+void RenderManager::finishStems( bool discard )
 {
-	while( !m_unmuted.isEmpty() )
+	if( m_stemExporter )
 	{
-		Track* restoreTrack = m_unmuted.back();
-		m_unmuted.pop_back();
-		restoreTrack->setMuted( false );
+		m_stemExporter->finish( discard );
+		m_stemExporter.reset();
+	}
+}
+
+AudioFileDevice * RenderManager::createFileDevice( const QString & path )
+{
+	AudioFileDeviceInstantiaton audioEncoderFactory =
+		ProjectRenderer::fileEncodeDevices[m_format].m_getDevInst;
+	if( !audioEncoderFactory )
+	{
+		return NULL;
+	}
+
+	bool successful = false;
+	AudioFileDevice * device = audioEncoderFactory( path, m_outputSettings,
+				DEFAULT_CHANNELS, Engine::mixer(), successful );
+	if( !successful )
+	{
+		delete device;
+		return NULL;
+	}
+	return device;
+}
+
+AudioPort * RenderManager::audioPortOf( Track * track )
+{
+	switch( track->type() )
+	{
+		case Track::InstrumentTrack:
+			return static_cast<InstrumentTrack *>( track )->audioPort();
+		case Track::SampleTrack:
+			return static_cast<SampleTrack *>( track )->audioPort();
+		default:
+			return NULL;
 	}
 }
 
@@ -183,18 +242,26 @@ QString RenderManager::pathForTrack(const Track *track, int num)
 	return QDir(m_outputPath).filePath(name);
 }
 
+// Determine the output path for an FX channel when rendering tracks individually
+QString RenderManager::pathForFxChannel(const FxChannel *channel, int num)
+{
+	QString extension = ProjectRenderer::getFileExtensionFromFormat( m_format );
+	QString name = channel->m_name;
+	name = name.remove(QRegExp("[^a-zA-Z]"));
+	name = QString( "FX%1_%2%3" ).arg( num ).arg( name ).arg( extension );
+	return QDir(m_outputPath).filePath(name);
+}
+
 void RenderManager::updateConsoleProgress()
 {
 	if ( m_activeRenderer )
 	{
 		m_activeRenderer->updateConsoleProgress();
 
-		int totalNum = m_unmuted.size();
-		if ( totalNum > 0 )
+		if ( m_stemExporter )
 		{
-			// we are rendering multiple tracks, append a track counter to the output
-			int trackNum = totalNum - m_tracksToRender.size();
-			fprintf( stderr, "(%d/%d)", trackNum, totalNum );
+			// we are rendering multiple tracks, append the number of files
+			fprintf( stderr, "(%d files)", m_stemExporter->stemCount() + 1 );
 		}
 	}
 }
@@ -55,6 +55,7 @@
 #include "Engine.h"
 #include "GuiApplication.h"
 #include "Mixer.h"
+#include "SampleCacheFile.h"
 
 #include "FileDialog.h"
 
@@ -65,6 +66,7 @@ SampleBuffer::SampleBuffer() :
 	m_origData( NULL ),
 	m_origFrames( 0 ),
 	m_data( NULL ),
+	m_cacheFile( NULL ),
 	m_frames( 0 ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
@@ -133,7 +135,25 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames )
 SampleBuffer::~SampleBuffer()
 {
 	MM_FREE( m_origData );
-	MM_FREE( m_data );
+	delete releaseData();
+}
+
+
+
+
+SampleCacheFile * SampleBuffer::releaseData()
+{
+	SampleCacheFile * cacheFile = m_cacheFile;
+	if( m_cacheFile )
+	{
+		m_cacheFile = NULL;
+		m_data = NULL;
+	}
+	else
+	{
+		MM_FREE( m_data );
+	}
+	return cacheFile;
 }
 
 
@@ -144,21 +164,61 @@ void SampleBuffer::sampleRateChanged()
 }
 
 
+// whether the file takes up more than the given number of bytes when being
+// decoded at our sample rate
+static bool decodedSizeExceeds( const QString & file, double bytes )
+{
+	// Use QFile to handle unicode file names on Windows
+	QFile f( file );
+	if( !f.open( QIODevice::ReadOnly ) )
+	{
+		return false;
+	}
+
+	SF_INFO sf_info;
+	sf_info.format = 0;
+	SNDFILE * snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false );
+	if( snd_file == NULL )
+	{
+		return false;
+	}
+	sf_close( snd_file );
+
+	return (double) sf_info.frames / sf_info.samplerate *
+			Engine::mixer()->baseSampleRate() * BYTES_PER_FRAME > bytes;
+}
+
+
+
+
 void SampleBuffer::update( bool _keep_settings )
 {
+	// Size limit of files which can't be streamed
+	const int fileSizeMax = 300; // MB
+	// Samples which take up more memory when decoded are streamed from a
+	// cache file instead
+	const int streamSizeMin = 64; // MB
+
+	// decoding into the cache file takes a while, so do it before holding
+	// off the mixer - only the mapping gets swapped in below
+	const bool stream = !m_audioFile.isEmpty() &&
+		decodedSizeExceeds( tryToMakeAbsolute( m_audioFile ),
+					streamSizeMin * 1024.0 * 1024.0 );
+	SampleCacheFile * cacheFile = stream ? SampleCacheFile::open(
+				tryToMakeAbsolute( m_audioFile ),
+				Engine::mixer()->baseSampleRate(), m_reversed ) : NULL;
+
 	const bool lock = ( m_data != NULL );
+	SampleCacheFile * oldCacheFile = NULL;
 	if( lock )
 	{
 		Engine::mixer()->requestChangeInModel();
 		m_varLock.lockForWrite();
-		MM_FREE( m_data );
+		oldCacheFile = releaseData();
 	}
 
-	// File size and sample length limits
-	const int fileSizeMax = 300; // MB
-	const int sampleLengthMax = 90; // Minutes
-
 	bool fileLoadError = false;
+	bool streamError = false;
 	if( m_audioFile.isEmpty() && m_origData != NULL && m_origFrames > 0 )
 	{
 		// TODO: reverse- and amplification-property is not covered
@@ -182,32 +242,25 @@ void SampleBuffer::update( bool _keep_settings )
 		m_frames = 0;
 
 		const QFileInfo fileInfo( file );
-		if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
+		if( stream )
 		{
-			fileLoadError = true;
-		}
-		else
-		{
-			// Use QFile to handle unicode file names on Windows
-			QFile f(file);
-			f.open(QIODevice::ReadOnly);
-			SNDFILE * snd_file;
-			SF_INFO sf_info;
-			sf_info.format = 0;
-			if( ( snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) != NULL )
+			m_cacheFile = cacheFile;
+			if( m_cacheFile )
 			{
-				f_cnt_t frames = sf_info.frames;
-				int rate = sf_info.samplerate;
-				if( frames / rate > sampleLengthMax * 60 )
-				{
-					fileLoadError = true;
-				}
-				sf_close( snd_file );
+				m_data = m_cacheFile->data();
+				m_frames = m_cacheFile->frames();
+			}
+			else
+			{
+				streamError = true;
 			}
-			f.close();
+		}
+		else if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
+		{
+			fileLoadError = true;
 		}
 
-		if( !fileLoadError )
+		if( !stream && !fileLoadError )
 		{
 #ifdef LMMS_HAVE_OGGVORBIS
 			// workaround for a bug in libsndfile or our libsndfile decoder
@@ -237,7 +290,7 @@ void SampleBuffer::update( bool _keep_settings )
 			}
 		}
 
-		if ( m_frames == 0 || fileLoadError )  // if still no frames, bail
+		if ( m_frames == 0 || fileLoadError || streamError )  // if still no frames, bail
 		{
 			// sample couldn't be decoded, create buffer containing
 			// one sample-frame
@@ -247,6 +300,15 @@ void SampleBuffer::update( bool _keep_settings )
 			m_loopStartFrame = m_startFrame = 0;
 			m_loopEndFrame = m_endFrame = 1;
 		}
+		else if( m_cacheFile )
+		{
+			// decoded at our sample rate already
+			if( _keep_settings == false )
+			{
+				m_loopStartFrame = m_startFrame = 0;
+				m_loopEndFrame = m_endFrame = m_frames;
+			}
+		}
 		else // otherwise normalize sample rate
 		{
 			normalizeSampleRate( samplerate, _keep_settings );
@@ -269,14 +331,20 @@ void SampleBuffer::update( bool _keep_settings )
 		Engine::mixer()->doneChangeInModel();
 	}
 
+	// not before the mixer runs again, there's no need to hold it off
+	// while the old file gets unmapped
+	delete oldCacheFile;
+
 	emit sampleUpdated();
 
-	if( fileLoadError )
+	if( fileLoadError || streamError )
 	{
 		QString title = tr( "Fail to open file" );
-		QString message = tr( "Audio files are limited to %1 MB "
-				"in size and %2 minutes of playing time"
-				).arg( fileSizeMax ).arg( sampleLengthMax );
+		QString message = fileLoadError ?
+			tr( "Audio files which can't be streamed are limited "
+				"to %1 MB in size" ).arg( fileSizeMax ) :
+			tr( "Could not decode the audio file into the "
+				"sample cache" );
 		if( gui )
 		{
 			QMessageBox::information( NULL,
@@ -666,6 +734,11 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame );
 	}
 
+	if( m_cacheFile )
+	{
+		m_cacheFile->prefetch( play_frame );
+	}
+
 	f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) + MARGIN[ _state->interpolationMode() ];
 
 	sampleFrame * tmp = NULL;
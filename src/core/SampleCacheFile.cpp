@@ -0,0 +1,477 @@
+/*
+ * SampleCacheFile.cpp - decoded samples in a memory mapped cache file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleCacheFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <vector>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <samplerate.h>
+#include <sndfile.h>
+
+
+// how far ahead of the play position the prefetcher reads
+static const int PREFETCH_SECONDS = 10;
+
+// how often the prefetcher looks at the play positions
+static const int PREFETCH_INTERVAL_MS = 20;
+
+// frames decoded at once
+static const f_cnt_t DECODE_FRAMES = 65536;
+
+// the least recently used cache files are deleted beyond this size
+static const qint64 CACHE_SIZE_MAX = 4096; // MB
+
+// size of the pages of the mapping - a smaller value than the actual one
+// only means some pages get touched twice
+static const f_cnt_t PAGE_FRAMES = 4096 / sizeof( sampleFrame );
+
+
+struct SampleCacheFile::Mapping
+{
+	Mapping( const QString & path, sample_rate_t sampleRate );
+	~Mapping();
+
+	// read in the pages from the play position on, called by the
+	// prefetcher
+	void touchAhead();
+
+	QFile file;
+	sampleFrame * data;
+	f_cnt_t frames;
+
+	std::atomic<f_cnt_t> playFrame;
+	const f_cnt_t prefetchFrames;
+	f_cnt_t prefetchedFrom;
+	f_cnt_t prefetchedTo;
+} ;
+
+
+
+
+class SampleCacheFile::Prefetcher : public QThread
+{
+public:
+	static void add( const std::shared_ptr<Mapping> & mapping )
+	{
+		Prefetcher & prefetcher = instance();
+		QMutexLocker lock( &prefetcher.m_mutex );
+		if( !prefetcher.isRunning() )
+		{
+			prefetcher.start( QThread::LowPriority );
+		}
+		prefetcher.m_mappings.push_back( mapping );
+		prefetcher.m_wake.wakeAll();
+	}
+
+	// doesn't wait for the prefetcher - if it's reading in pages of the
+	// mapping right now, its reference keeps the mapping alive until done
+	static void remove( const Mapping * mapping )
+	{
+		Prefetcher & prefetcher = instance();
+		QMutexLocker lock( &prefetcher.m_mutex );
+		std::vector<std::shared_ptr<Mapping> > & mappings = prefetcher.m_mappings;
+		mappings.erase( std::remove_if( mappings.begin(), mappings.end(),
+				[mapping]( const std::shared_ptr<Mapping> & m )
+					{ return m.get() == mapping; } ),
+							mappings.end() );
+	}
+
+	virtual ~Prefetcher()
+	{
+		m_mutex.lock();
+		m_quit = true;
+		m_wake.wakeAll();
+		m_mutex.unlock();
+		wait();
+	}
+
+private:
+	Prefetcher() :
+		m_quit( false )
+	{
+	}
+
+	static Prefetcher & instance()
+	{
+		static Prefetcher prefetcher;
+		return prefetcher;
+	}
+
+	virtual void run()
+	{
+		std::vector<std::shared_ptr<Mapping> > snapshot;
+		QMutexLocker lock( &m_mutex );
+		while( !m_quit )
+		{
+			// the disk is only waited for without holding the mutex
+			snapshot = m_mappings;
+			lock.unlock();
+			for( const std::shared_ptr<Mapping> & mapping : snapshot )
+			{
+				mapping->touchAhead();
+			}
+			// mappings removed meanwhile are unmapped here
+			snapshot.clear();
+			lock.relock();
+
+			if( !m_quit )
+			{
+				m_wake.wait( &m_mutex, m_mappings.empty() ?
+						ULONG_MAX : PREFETCH_INTERVAL_MS );
+			}
+		}
+	}
+
+	QMutex m_mutex;
+	QWaitCondition m_wake;
+	std::vector<std::shared_ptr<Mapping> > m_mappings;
+	bool m_quit;
+
+} ;
+
+
+
+
+SampleCacheFile * SampleCacheFile::open( const QString & audioFile,
+				sample_rate_t sampleRate, bool reversed )
+{
+	const QString path = cachePath( audioFile, sampleRate, reversed );
+	if( !QFileInfo( path ).exists() )
+	{
+		QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+		// decode into a temporary file first, so that nothing half
+		// written is picked up if we get interrupted
+		const QString tempPath = path + ".part";
+		const bool decoded = decode( audioFile, tempPath, sampleRate, reversed ) &&
+						QFile::rename( tempPath, path );
+		QFile::remove( tempPath );
+		if( !decoded )
+		{
+			return NULL;
+		}
+		trimCache( QFileInfo( path ).absolutePath(), path );
+	}
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	else
+	{
+		// keep it from being trimmed as one of the least recently used
+		QFile cached( path );
+		if( cached.open( QIODevice::ReadWrite ) )
+		{
+			cached.setFileTime( QDateTime::currentDateTime(),
+						QFileDevice::FileModificationTime );
+		}
+	}
+#endif
+
+	SampleCacheFile * file = new SampleCacheFile( path, sampleRate );
+	if( file->m_data == NULL )
+	{
+		delete file;
+		return NULL;
+	}
+	return file;
+}
+
+
+
+
+SampleCacheFile::SampleCacheFile( const QString & path,
+						sample_rate_t sampleRate ) :
+	m_mapping( std::make_shared<Mapping>( path, sampleRate ) ),
+	m_data( m_mapping->data ),
+	m_frames( m_mapping->frames )
+{
+	if( m_data != NULL )
+	{
+		Prefetcher::add( m_mapping );
+	}
+}
+
+
+
+
+SampleCacheFile::~SampleCacheFile()
+{
+	if( m_data != NULL )
+	{
+		Prefetcher::remove( m_mapping.get() );
+	}
+}
+
+
+
+
+void SampleCacheFile::prefetch( f_cnt_t frame )
+{
+	m_mapping->playFrame.store( frame, std::memory_order_relaxed );
+}
+
+
+
+
+SampleCacheFile::Mapping::Mapping( const QString & path,
+						sample_rate_t sampleRate ) :
+	file( path ),
+	data( NULL ),
+	frames( 0 ),
+	playFrame( 0 ),
+	prefetchFrames( sampleRate * PREFETCH_SECONDS ),
+	prefetchedFrom( 0 ),
+	prefetchedTo( 0 )
+{
+	if( file.open( QIODevice::ReadOnly ) &&
+				file.size() >= (qint64) sizeof( sampleFrame ) )
+	{
+		frames = file.size() / sizeof( sampleFrame );
+		data = reinterpret_cast<sampleFrame *>( file.map( 0,
+					frames * sizeof( sampleFrame ) ) );
+	}
+}
+
+
+
+
+SampleCacheFile::Mapping::~Mapping()
+{
+	if( data != NULL )
+	{
+		file.unmap( reinterpret_cast<uchar *>( data ) );
+	}
+}
+
+
+
+
+// Cache files are named after what they have been decoded from, so that a
+// file which has been changed gets decoded again
+QString SampleCacheFile::cachePath( const QString & audioFile,
+				sample_rate_t sampleRate, bool reversed )
+{
+	const QFileInfo info( audioFile );
+	const QString key = QString( "%1\n%2\n%3\n%4\n%5" ).
+				arg( info.absoluteFilePath() ).
+				arg( info.size() ).
+				arg( info.lastModified().toMSecsSinceEpoch() ).
+				arg( sampleRate ).
+				arg( reversed );
+	const QString name = QCryptographicHash::hash( key.toUtf8(),
+				QCryptographicHash::Sha1 ).toHex();
+
+	return QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) +
+					"/samples/" + name + ".f32";
+}
+
+
+
+
+// Deletes the oldest cache files until the cache fits into CACHE_SIZE_MAX -
+// files which are mapped at the moment stay intact on all systems, they
+// are either deleted after being unmapped or can't be deleted at all
+void SampleCacheFile::trimCache( const QString & dir, const QString & keep )
+{
+	const QFileInfoList files = QDir( dir ).entryInfoList(
+			QStringList( "*.f32" ), QDir::Files, QDir::Time );
+
+	qint64 size = 0;
+	for( const QFileInfo & file : files )
+	{
+		size += file.size();
+	}
+
+	// oldest first
+	for( int i = files.size() - 1; i >= 0 &&
+				size > CACHE_SIZE_MAX * 1024 * 1024; --i )
+	{
+		if( files[i].absoluteFilePath() != QFileInfo( keep ).absoluteFilePath() &&
+				QFile::remove( files[i].absoluteFilePath() ) )
+		{
+			size -= files[i].size();
+		}
+	}
+}
+
+
+
+
+bool SampleCacheFile::decode( const QString & audioFile, const QString & path,
+				sample_rate_t sampleRate, bool reversed )
+{
+	// Use QFile to handle unicode file names on Windows
+	QFile in( audioFile );
+	if( !in.open( QIODevice::ReadOnly ) )
+	{
+		return false;
+	}
+
+	SF_INFO info;
+	info.format = 0;
+	SNDFILE * sndFile = sf_open_fd( in.handle(), SFM_READ, &info, false );
+	if( sndFile == NULL )
+	{
+		return false;
+	}
+
+	QFile out( path );
+	if( !out.open( QIODevice::ReadWrite | QIODevice::Truncate ) )
+	{
+		sf_close( sndFile );
+		return false;
+	}
+
+	SRC_STATE * srcState = NULL;
+	const double ratio = (double) sampleRate / info.samplerate;
+	if( info.samplerate != (int) sampleRate )
+	{
+		int error;
+		srcState = src_new( SRC_SINC_MEDIUM_QUALITY, DEFAULT_CHANNELS, &error );
+		if( srcState == NULL )
+		{
+			sf_close( sndFile );
+			return false;
+		}
+	}
+
+	std::vector<float> input( DECODE_FRAMES * info.channels );
+	std::vector<sample_t> stereo( DECODE_FRAMES * DEFAULT_CHANNELS );
+	std::vector<sample_t> resampled( ( DECODE_FRAMES * ratio + 64 ) *
+							DEFAULT_CHANNELS );
+	const int ch = info.channels > 1 ? 1 : 0;
+	bool successful = true;
+
+	bool endOfInput = false;
+	while( !endOfInput && successful )
+	{
+		const f_cnt_t read = sf_readf_float( sndFile, input.data(),
+								DECODE_FRAMES );
+		endOfInput = read < DECODE_FRAMES;
+
+		for( f_cnt_t f = 0; f < read; ++f )
+		{
+			stereo[f * 2 + 0] = input[f * info.channels + 0];
+			stereo[f * 2 + 1] = input[f * info.channels + ch];
+		}
+
+		if( srcState == NULL )
+		{
+			const qint64 bytes = read * sizeof( sampleFrame );
+			successful = out.write( (const char *) stereo.data(),
+							bytes ) == bytes;
+			continue;
+		}
+
+		// libsamplerate may not take all of the input at once
+		f_cnt_t used = 0;
+		SRC_DATA srcData;
+		do
+		{
+			srcData.data_in = stereo.data() + used * DEFAULT_CHANNELS;
+			srcData.input_frames = read - used;
+			srcData.data_out = resampled.data();
+			srcData.output_frames = resampled.size() / DEFAULT_CHANNELS;
+			srcData.src_ratio = ratio;
+			srcData.end_of_input = endOfInput;
+			if( src_process( srcState, &srcData ) )
+			{
+				successful = false;
+				break;
+			}
+			used += srcData.input_frames_used;
+
+			const qint64 bytes = srcData.output_frames_gen *
+							sizeof( sampleFrame );
+			successful = out.write( (const char *) resampled.data(),
+							bytes ) == bytes;
+		}
+		while( successful && ( used < read ||
+				( endOfInput && srcData.output_frames_gen > 0 ) ) );
+	}
+
+	if( srcState != NULL )
+	{
+		src_delete( srcState );
+	}
+	sf_close( sndFile );
+	out.flush();
+
+	const f_cnt_t totalFrames = out.size() / sizeof( sampleFrame );
+	if( !successful || totalFrames == 0 )
+	{
+		return false;
+	}
+
+	if( reversed )
+	{
+		sampleFrame * data = reinterpret_cast<sampleFrame *>(
+			out.map( 0, totalFrames * sizeof( sampleFrame ) ) );
+		if( data == NULL )
+		{
+			return false;
+		}
+		for( f_cnt_t f = 0; f < totalFrames / 2; ++f )
+		{
+			std::swap( data[f][0], data[totalFrames - 1 - f][0] );
+			std::swap( data[f][1], data[totalFrames - 1 - f][1] );
+		}
+		out.unmap( reinterpret_cast<uchar *>( data ) );
+	}
+
+	return true;
+}
+
+
+
+
+void SampleCacheFile::Mapping::touchAhead()
+{
+	const f_cnt_t from = qBound<f_cnt_t>( 0,
+			playFrame.load( std::memory_order_relaxed ), frames );
+	const f_cnt_t to = qMin( from + prefetchFrames, frames );
+
+	// start over after seeking, carry on otherwise
+	f_cnt_t frame = from >= prefetchedFrom && from <= prefetchedTo ?
+							prefetchedTo : from;
+
+	volatile sample_t sink = 0;
+	for( ; frame < to; frame += PAGE_FRAMES )
+	{
+		sink = data[frame][0];
+	}
+	Q_UNUSED( sink );
+
+	prefetchedFrom = from;
+	prefetchedTo = frame;
+}
@@ -31,6 +31,7 @@
 #include <QMessageBox>
 
 #include <functional>
+#include <limits>
 
 #include "AutomationTrack.h"
 #include "AutomationEditor.h"
@@ -77,6 +78,9 @@ Song::Song() :
 	m_exporting( false ),
 	m_exportLoop( false ),
 	m_renderBetweenMarkers( false ),
+	m_exportRange( false ),
+	m_exportRangeBegin(),
+	m_exportRangeEnd(),
 	m_playing( false ),
 	m_paused( false ),
 	m_loadingProject( false ),
@@ -367,7 +371,7 @@ void Song::processNextBuffer()
 
 		if( ( f_cnt_t ) currentFrame == 0 )
 		{
-			processAutomations(trackList, m_playPos[m_playMode], framesToPlay);
+			processAutomations(trackList, m_playPos[m_playMode], framesPlayed, 0.0f);
 
 			// loop through all tracks and play them
 			for( int i = 0; i < trackList.size(); ++i )
@@ -377,6 +381,13 @@ void Song::processNextBuffer()
 						framesPlayed, tcoNum );
 			}
 		}
+		else if( framesPlayed == 0 )
+		{
+			// period starts within a tick - continue the automation
+			// curves of the current tick from where they are
+			processAutomations(trackList, m_playPos[m_playMode], 0,
+							currentFrame / framesPerTick);
+		}
 
 		// update frame-counters
 		framesPlayed += framesToPlay;
@@ -389,7 +400,7 @@ void Song::processNextBuffer()
 }
 
 
-void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fpp_t)
+void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, f_cnt_t offset, float tickOffset)
 {
 	AutomatedValueMap values;
 
@@ -416,14 +427,38 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 		return;
 	}
 
-	values = container->automatedValuesAt(timeStart, tcoNum);
+	if (tickOffset > 0 && tcoNum >= 0)
+	{
+		// nothing to render, only song automation is sample-exact
+		return;
+	}
+
+	AutomationPatternMap patterns;
+	if (tcoNum < 0)
+	{
+		// same as automatedValuesAt(timeStart), but only looks at the
+		// TCOs which matter at the current position
+		values = m_automationCursor.valuesAt(TrackList{m_globalAutomationTrack} << tracks(), timeStart, &patterns);
+	}
+	else
+	{
+		values = container->automatedValuesAt(timeStart, tcoNum);
+	}
+
+	if (tickOffset > 0)
+	{
+		renderAutomations(patterns, recordedModels, timeStart, tickOffset, offset);
+		return;
+	}
+
 	TrackList tracks = container->tracks();
 
+	// only TCOs playing right now can be recording
 	Track::tcoVector tcos;
 	for (Track* track : tracks)
 	{
 		if (track->type() == Track::AutomationTrack) {
-			track->getTCOsInRange(tcos, 0, timeStart);
+			track->getTCOsInRange(tcos, timeStart, timeStart);
 		}
 	}
 
@@ -449,6 +484,41 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 			it.key()->setAutomatedValue(it.value());
 		}
 	}
+
+	renderAutomations(patterns, recordedModels, timeStart, 0.0f, offset);
+}
+
+
+void Song::renderAutomations(const AutomationPatternMap &patterns, const QSet<const AutomatableModel*> &skip,
+					MidiTime time, float tickOffset, f_cnt_t offset)
+{
+	const f_cnt_t frames = Engine::mixer()->framesPerPeriod() - offset;
+	const float ticksPerFrame = 1.0f / Engine::framesPerTick();
+
+	if (m_automationValues.size() < static_cast<size_t>(frames))
+	{
+		m_automationValues.resize(Engine::mixer()->framesPerPeriod());
+	}
+
+	// render until the end of the period, the next tick starting within it
+	// overwrites the rest
+	for (auto it = patterns.begin(); it != patterns.end(); it++)
+	{
+		if (skip.contains(it.key()))
+		{
+			continue;
+		}
+
+		const AutomationPattern* p = it.value();
+		if (p->isRecording())
+		{
+			continue;
+		}
+		const float lastTick = p->getAutoResize() ? std::numeric_limits<float>::max() : p->length().getTicks();
+		p->valuesAt(time - p->startPosition() + tickOffset, ticksPerFrame, lastTick,
+						m_automationValues.data(), frames);
+		it.key()->setAutomatedValues(m_automationValues.data(), offset, frames);
+	}
 }
 
 void Song::setModified(bool value)
@@ -462,7 +532,11 @@ void Song::setModified(bool value)
 
 std::pair<MidiTime, MidiTime> Song::getExportEndpoints() const
 {
-	if ( m_renderBetweenMarkers )
+	if ( m_exportRange )
+	{
+		return std::pair<MidiTime, MidiTime>( m_exportRangeBegin, m_exportRangeEnd );
+	}
+	else if ( m_renderBetweenMarkers )
 	{
 		return std::pair<MidiTime, MidiTime>(
 			m_playPos[Mode_PlaySong].m_timeLine->loopBegin(),
@@ -702,7 +776,11 @@ void Song::stop()
 void Song::startExport()
 {
 	stop();
-	if(m_renderBetweenMarkers)
+	if(m_exportRange)
+	{
+		m_playPos[Mode_PlaySong].setTicks( m_exportRangeBegin.getTicks() );
+	}
+	else if(m_renderBetweenMarkers)
 	{
 		m_playPos[Mode_PlaySong].setTicks( m_playPos[Mode_PlaySong].m_timeLine->loopBegin().getTicks() );
 	}
@@ -726,6 +804,7 @@ void Song::stopExport()
 	stop();
 	m_exporting = false;
 	m_exportLoop = false;
+	m_exportRange = false;
 
 	m_vstSyncController.setPlaybackState( m_playing );
 }
@@ -1330,10 +1409,14 @@ void Song::removeController( Controller * controller )
 	int index = m_controllers.indexOf( controller );
 	if( index != -1 )
 	{
+		// deleting the controller deletes its connections, which the
+		// mixer might be queueing at the moment
+		Engine::mixer()->requestChangeInModel();
 		m_controllers.remove( index );
 
 		emit controllerRemoved( controller );
 		delete controller;
+		Engine::mixer()->doneChangeInModel();
 
 		this->setModified();
 	}
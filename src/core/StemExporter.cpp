@@ -0,0 +1,288 @@
+/*
+ * StemExporter.cpp - writes output of single tracks and FX channels to files
+ *                    while the song is rendered once
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "StemExporter.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+
+#include "AudioFileDevice.h"
+#include "AudioPort.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "MemoryManager.h"
+#include "Mixer.h"
+#include "ValueBuffer.h"
+
+
+// number of periods each stem can be ahead of its encoder
+static const int RING_PERIODS = 64;
+
+
+class StemExporter::EncoderThread : public QThread
+{
+public:
+	EncoderThread( StemExporter * exporter, int index ) :
+		m_exporter( exporter ),
+		m_index( index )
+	{
+	}
+
+private:
+	virtual void run()
+	{
+		MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
+
+		while( true )
+		{
+			if( m_exporter->encode( m_index ) )
+			{
+				QMutexLocker lock( &m_exporter->m_mutex );
+				m_exporter->m_spaceAvailable.wakeAll();
+				continue;
+			}
+
+			QMutexLocker lock( &m_exporter->m_mutex );
+			if( m_exporter->hasPending( m_index ) )
+			{
+				continue;
+			}
+			if( m_exporter->m_quit )
+			{
+				break;
+			}
+			m_exporter->m_dataAvailable.wait( &m_exporter->m_mutex );
+		}
+	}
+
+	StemExporter * m_exporter;
+	int m_index;
+
+} ;
+
+
+
+
+StemExporter::StemExporter() :
+	m_stems(),
+	m_threads(),
+	m_numThreads( 0 ),
+	m_framesPerPeriod( Engine::mixer()->framesPerPeriod() ),
+	m_quit( false )
+{
+}
+
+
+
+
+StemExporter::~StemExporter()
+{
+	finish( true );
+}
+
+
+
+
+void StemExporter::addStem( AudioPort * port, AudioFileDevice * device )
+{
+	addStem( port, NULL, device );
+}
+
+
+
+
+void StemExporter::addStem( FxChannel * channel, AudioFileDevice * device )
+{
+	addStem( NULL, channel, device );
+}
+
+
+
+
+void StemExporter::addStem( AudioPort * port, FxChannel * channel, AudioFileDevice * device )
+{
+	Stem * stem = new Stem;
+	stem->port = port;
+	stem->channel = channel;
+	stem->device = device;
+	stem->ring = new surroundSampleFrame[RING_PERIODS * m_framesPerPeriod];
+	stem->head = 0;
+	stem->tail = 0;
+	m_stems.push_back( stem );
+}
+
+
+
+
+void StemExporter::start()
+{
+	// encoding usually is a lot cheaper than rendering, so leave most
+	// cores to the mixer
+	m_numThreads = qBound( 1, QThread::idealThreadCount() / 2,
+							qMax<int>( m_stems.size(), 1 ) );
+	for( int i = 0; i < m_numThreads; ++i )
+	{
+		m_threads.push_back( new EncoderThread( this, i ) );
+		m_threads.back()->start();
+	}
+}
+
+
+
+
+void StemExporter::capture()
+{
+	for( Stem * stem : m_stems )
+	{
+		const int head = stem->head.load( std::memory_order_relaxed );
+		if( head - stem->tail.load( std::memory_order_acquire ) >= RING_PERIODS )
+		{
+			QMutexLocker lock( &m_mutex );
+			while( head - stem->tail.load( std::memory_order_acquire ) >= RING_PERIODS )
+			{
+				m_spaceAvailable.wait( &m_mutex );
+			}
+		}
+
+		copyOutput( stem, stem->ring + ( head % RING_PERIODS ) * m_framesPerPeriod );
+		stem->head.store( head + 1, std::memory_order_release );
+	}
+
+	QMutexLocker lock( &m_mutex );
+	m_dataAvailable.wakeAll();
+}
+
+
+
+
+void StemExporter::copyOutput( Stem * stem, surroundSampleFrame * dst )
+{
+	const sampleFrame * src = NULL;
+	// master gain may change while the encoders are lagging behind, so
+	// apply it right away
+	float volume = Engine::mixer()->masterGain();
+	const float masterGain = volume;
+	const float * volumeBuffer = NULL;
+
+	if( stem->port )
+	{
+		if( stem->port->hasOutput() )
+		{
+			src = stem->port->buffer();
+		}
+	}
+	else if( !stem->channel->m_muted &&
+			( stem->channel->m_hasInput || stem->channel->m_stillRunning ) )
+	{
+		// channel volume is applied by the receiving channel, so do it
+		// here as well
+		src = stem->channel->m_buffer;
+		if( ValueBuffer * volBuf = stem->channel->m_volumeModel.valueBuffer() )
+		{
+			volumeBuffer = volBuf->values();
+		}
+		else
+		{
+			volume *= stem->channel->m_volumeModel.value();
+		}
+	}
+
+	for( fpp_t f = 0; f < m_framesPerPeriod; ++f )
+	{
+		const float v = volumeBuffer ? volumeBuffer[f] * masterGain : volume;
+		for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+		{
+			dst[f][ch] = src ? src[f][ch % DEFAULT_CHANNELS] * v : 0.0f;
+		}
+	}
+}
+
+
+
+
+bool StemExporter::encode( int thread )
+{
+	bool encoded = false;
+	for( int i = thread; i < (int) m_stems.size(); i += m_numThreads )
+	{
+		Stem * stem = m_stems[i];
+		int tail = stem->tail.load( std::memory_order_relaxed );
+		while( tail != stem->head.load( std::memory_order_acquire ) )
+		{
+			stem->device->writeRenderedBuffer( stem->ring +
+					( tail % RING_PERIODS ) * m_framesPerPeriod,
+							m_framesPerPeriod, 1.0f );
+			stem->tail.store( ++tail, std::memory_order_release );
+			encoded = true;
+		}
+	}
+	return encoded;
+}
+
+
+
+
+bool StemExporter::hasPending( int thread ) const
+{
+	for( int i = thread; i < (int) m_stems.size(); i += m_numThreads )
+	{
+		if( m_stems[i]->tail.load( std::memory_order_acquire ) !=
+				m_stems[i]->head.load( std::memory_order_acquire ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+void StemExporter::finish( bool discard )
+{
+	m_mutex.lock();
+	m_quit = true;
+	m_dataAvailable.wakeAll();
+	m_mutex.unlock();
+
+	for( EncoderThread * thread : m_threads )
+	{
+		thread->wait();
+		delete thread;
+	}
+	m_threads.clear();
+
+	for( Stem * stem : m_stems )
+	{
+		const QString file = stem->device->outputFile();
+		// finishes encoding
+		delete stem->device;
+		if( discard )
+		{
+			QFile( file ).remove();
+		}
+		delete[] stem->ring;
+		delete stem;
+	}
+	m_stems.clear();
+}
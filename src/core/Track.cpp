@@ -37,7 +37,9 @@
 
 #include "Track.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <climits>
 
 #include <QLayout>
 #include <QMenu>
@@ -146,6 +148,10 @@ void TrackContentObject::movePosition( const MidiTime & pos )
 		Engine::mixer()->requestChangeInModel();
 		m_startPosition = pos;
 		Engine::mixer()->doneChangeInModel();
+		if( getTrack() )
+		{
+			getTrack()->invalidateTCOIndex();
+		}
 		Engine::getSong()->updateLength();
 		emit positionChanged();
 	}
@@ -164,6 +170,10 @@ void TrackContentObject::movePosition( const MidiTime & pos )
 void TrackContentObject::changeLength( const MidiTime & length )
 {
 	m_length = length;
+	if( getTrack() )
+	{
+		getTrack()->invalidateTCOIndex();
+	}
 	Engine::getSong()->updateLength();
 	emit lengthChanged();
 }
@@ -1971,6 +1981,11 @@ void TrackOperationsWidget::recordingOff()
 // track
 // ===========================================================================
 
+
+std::atomic<unsigned int> Track::s_tcoRevisions( 0 );
+
+
+
 /*! \brief Create a new (empty) track object
  *
  *  The track object is the whole track, linking its contents, its
@@ -1991,7 +2006,10 @@ Track::Track( TrackTypes type, TrackContainer * tc ) :
 	m_soloModel( false, this, tr( "Solo" ) ),
 					/*!< For controlling track soloing */
 	m_simpleSerializingMode( false ),
-	m_trackContentObjects()         /*!< The track content objects (segments) */
+	m_trackContentObjects(),        /*!< The track content objects (segments) */
+	m_tcoIndex(),
+	m_tcoIndexDirty( false ),
+	m_tcoRevision( ++s_tcoRevisions )
 {
 	m_trackContainer->addTrack( this );
 	m_height = -1;
@@ -2243,7 +2261,10 @@ void Track::loadSettings( const QDomElement & element )
  */
 TrackContentObject * Track::addTCO( TrackContentObject * tco )
 {
+	Engine::mixer()->requestChangeInModel();
 	m_trackContentObjects.push_back( tco );
+	invalidateTCOIndex();
+	Engine::mixer()->doneChangeInModel();
 
 	emit trackContentObjectAdded( tco );
 
@@ -2264,7 +2285,19 @@ void Track::removeTCO( TrackContentObject * tco )
 					tco );
 	if( it != m_trackContentObjects.end() )
 	{
+		// make sure the mixer isn't looking at the index while it still
+		// references the TCO - there's no mixer anymore when the song
+		// gets destroyed
+		if( Engine::mixer() )
+		{
+			Engine::mixer()->requestChangeInModel();
+		}
 		m_trackContentObjects.erase( it );
+		invalidateTCOIndex();
+		if( Engine::mixer() )
+		{
+			Engine::mixer()->doneChangeInModel();
+		}
 		if( Engine::getSong() )
 		{
 			Engine::getSong()->updateLength();
@@ -2356,6 +2389,14 @@ int Track::getTCONum( const TrackContentObject * tco )
  *
  *  We return the TCOs we find in order by time, earliest TCOs first.
  *
+ *  The lookup is done in the sorted index, so only TCOs starting before
+ *  the end of the range and not ending before the latest earlier TCO
+ *  are looked at, no matter how many TCOs the track has.
+ *
+ *  Only to be called by the mixer while rendering - TCOs are added and
+ *  removed under Mixer::requestChangeInModel(), so no further locking is
+ *  needed.
+ *
  *  \param tcoV The list to contain the found trackContentObjects.
  *  \param start The MIDI start time of the range.
  *  \param end   The MIDI endi time of the range.
@@ -2363,18 +2404,64 @@ int Track::getTCONum( const TrackContentObject * tco )
 void Track::getTCOsInRange( tcoVector & tcoV, const MidiTime & start,
 							const MidiTime & end )
 {
-	for( TrackContentObject* tco : m_trackContentObjects )
+	if( m_tcoIndexDirty.exchange( false ) )
+	{
+		rebuildTCOIndex();
+	}
+
+	// TCOs behind this one start after the given range
+	const auto last = std::upper_bound( m_tcoIndex.begin(), m_tcoIndex.end(), (int) end,
+		[]( int pos, const TCOIndexEntry & e ) { return pos < e.start; } );
+	// maxEnd is ascending, so all TCOs before this one end before the range
+	const auto first = std::lower_bound( m_tcoIndex.begin(), last, (int) start,
+		[]( const TCOIndexEntry & e, int pos ) { return e.maxEnd < pos; } );
+
+	const int found = tcoV.size();
+	for( auto it = first; it != last; ++it )
 	{
-		int s = tco->startPosition();
-		int e = tco->endPosition();
-		if( ( s <= end ) && ( e >= start ) )
+		if( it->end >= start )
 		{
-			// TCO is within given range
-			// Insert sorted by TCO's position
-			tcoV.insert(std::upper_bound(tcoV.begin(), tcoV.end(), tco, TrackContentObject::comparePosition),
-						tco);
+			// TCO is within given range, comes out sorted by position
+			tcoV.push_back( it->tco );
 		}
 	}
+
+	// callers may collect TCOs of several tracks in tcoV
+	if( found > 0 && found < tcoV.size() &&
+		TrackContentObject::comparePosition( tcoV[found], tcoV[found - 1] ) )
+	{
+		std::inplace_merge( tcoV.begin(), tcoV.begin() + found, tcoV.end(),
+						TrackContentObject::comparePosition );
+	}
+}
+
+
+
+
+/*! \brief Rebuild the index used by getTCOsInRange()
+ *
+ *  Has to be called by the mixer while rendering. TCOs with equal start
+ *  positions keep the order they have in m_trackContentObjects.
+ */
+void Track::rebuildTCOIndex()
+{
+	m_tcoIndex.clear();
+	m_tcoIndex.reserve( m_trackContentObjects.size() );
+	for( TrackContentObject * tco : m_trackContentObjects )
+	{
+		const TCOIndexEntry e = { tco->startPosition(), tco->endPosition(), 0, tco };
+		m_tcoIndex.push_back( e );
+	}
+
+	std::stable_sort( m_tcoIndex.begin(), m_tcoIndex.end(),
+		[]( const TCOIndexEntry & a, const TCOIndexEntry & b ) { return a.start < b.start; } );
+
+	int maxEnd = INT_MIN;
+	for( TCOIndexEntry & e : m_tcoIndex )
+	{
+		maxEnd = qMax( maxEnd, e.end );
+		e.maxEnd = maxEnd;
+	}
 }
 
 
@@ -280,6 +280,13 @@ AutomatedValueMap TrackContainer::automatedValuesFromTracks(const TrackList &tra
 		}
 	}
 
+	return automatedValuesFromTCOs(tcos, time);
+}
+
+
+AutomatedValueMap TrackContainer::automatedValuesFromTCOs(const Track::tcoVector &tcos, MidiTime time,
+								AutomationPatternMap *patterns)
+{
 	AutomatedValueMap valueMap;
 
 	Q_ASSERT(std::is_sorted(tcos.begin(), tcos.end(), TrackContentObject::comparePosition));
@@ -304,6 +311,9 @@ AutomatedValueMap TrackContainer::automatedValuesFromTracks(const TrackList &tra
 			for (AutomatableModel* model : p->objects())
 			{
 				valueMap[model] = value;
+				if (patterns) {
+					(*patterns)[model] = p;
+				}
 			}
 		}
 		else if (auto* bb = dynamic_cast<BBTCO *>(tco))
@@ -320,6 +330,9 @@ AutomatedValueMap TrackContainer::automatedValuesFromTracks(const TrackList &tra
 			{
 				// override old values, bb track with the highest index takes precedence
 				valueMap[it.key()] = it.value();
+				if (patterns) {
+					patterns->remove(it.key());
+				}
 			}
 		}
 		else
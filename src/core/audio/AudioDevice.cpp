@@ -106,11 +106,6 @@ fpp_t AudioDevice::getNextBuffer( surroundSampleFrame * _ab )
 	// release lock
 	unlock();
 
-	if( mixer()->hasFifoWriter() )
-	{
-		delete[] b;
-	}
-
 	return frames;
 }
 
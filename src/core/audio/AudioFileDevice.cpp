@@ -28,6 +28,7 @@
 #include "AudioFileDevice.h"
 #include "ExportProjectDialog.h"
 #include "GuiApplication.h"
+#include "Mixer.h"
 
 
 AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
@@ -36,7 +37,9 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 					Mixer*  _mixer ) :
 	AudioDevice( _channels, _mixer ),
 	m_outputFile( _file ),
-	m_outputSettings(outputSettings)
+	m_outputSettings(outputSettings),
+	m_resampleBuffer( new surroundSampleFrame[
+			qMax( _mixer->framesPerPeriod(), MaxRenderedFrames )] )
 {
 	setSampleRate( outputSettings.getSampleRate() );
 
@@ -72,6 +75,25 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 AudioFileDevice::~AudioFileDevice()
 {
 	m_outputFile.close();
+	delete[] m_resampleBuffer;
+}
+
+
+
+
+void AudioFileDevice::writeRenderedBuffer( const surroundSampleFrame * buffer,
+						fpp_t frames, float masterGain )
+{
+	const sample_rate_t processingRate = mixer()->processingSampleRate();
+	if( processingRate != sampleRate() )
+	{
+		// processing rate is a multiple of the output rate, so the
+		// result never has more frames than the input
+		resample( buffer, frames, m_resampleBuffer, processingRate, sampleRate() );
+		frames = frames * sampleRate() / processingRate;
+		buffer = m_resampleBuffer;
+	}
+	writeBuffer( buffer, frames, masterGain );
 }
 
 
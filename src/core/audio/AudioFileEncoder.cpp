@@ -0,0 +1,152 @@
+/*
+ * AudioFileEncoder.cpp - encodes rendered periods on a separate thread
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AudioFileEncoder.h"
+
+#include "AudioFileDevice.h"
+#include "MemoryManager.h"
+
+
+AudioFileEncoder::AudioFileEncoder( AudioFileDevice * device,
+						fpp_t framesPerPeriod ) :
+	m_device( device ),
+	m_framesPerPeriod( framesPerPeriod ),
+	// whole periods only, so that a period never spans two blocks
+	m_framesPerBlock( qMax<fpp_t>( framesPerPeriod,
+			AudioFileDevice::MaxRenderedFrames / framesPerPeriod *
+							framesPerPeriod ) ),
+	m_head( 0 ),
+	m_tail( 0 ),
+	m_fill( 0 ),
+	m_quit( false )
+{
+	for( int i = 0; i < NUM_BLOCKS; ++i )
+	{
+		m_blocks[i] = new surroundSampleFrame[m_framesPerBlock];
+		m_blockFrames[i] = 0;
+	}
+}
+
+
+
+
+AudioFileEncoder::~AudioFileEncoder()
+{
+	if( isRunning() )
+	{
+		finish();
+	}
+
+	for( int i = 0; i < NUM_BLOCKS; ++i )
+	{
+		delete[] m_blocks[i];
+	}
+}
+
+
+
+
+void AudioFileEncoder::write( const surroundSampleFrame * period,
+					fpp_t frames, float masterGain )
+{
+	if( m_fill == 0 )
+	{
+		// starting a new block - wait until the encoder is done with it
+		QMutexLocker lock( &m_mutex );
+		while( m_head - m_tail >= NUM_BLOCKS )
+		{
+			m_spaceAvailable.wait( &m_mutex );
+		}
+	}
+
+	surroundSampleFrame * dst = m_blocks[m_head % NUM_BLOCKS] + m_fill;
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+		{
+			dst[f][ch] = period[f][ch] * masterGain;
+		}
+	}
+	m_fill += frames;
+
+	// keep room for another whole period
+	if( m_fill + m_framesPerPeriod > m_framesPerBlock )
+	{
+		QMutexLocker lock( &m_mutex );
+		m_blockFrames[m_head % NUM_BLOCKS] = m_fill;
+		++m_head;
+		m_fill = 0;
+		m_dataAvailable.wakeAll();
+	}
+}
+
+
+
+
+void AudioFileEncoder::finish()
+{
+	QMutexLocker lock( &m_mutex );
+	if( m_fill > 0 )
+	{
+		m_blockFrames[m_head % NUM_BLOCKS] = m_fill;
+		++m_head;
+		m_fill = 0;
+	}
+	m_quit = true;
+	m_dataAvailable.wakeAll();
+	lock.unlock();
+
+	wait();
+}
+
+
+
+
+void AudioFileEncoder::run()
+{
+	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
+
+	QMutexLocker lock( &m_mutex );
+	while( true )
+	{
+		if( m_tail == m_head )
+		{
+			if( m_quit )
+			{
+				break;
+			}
+			m_dataAvailable.wait( &m_mutex );
+			continue;
+		}
+
+		const int block = m_tail % NUM_BLOCKS;
+		const fpp_t frames = m_blockFrames[block];
+		lock.unlock();
+
+		// gain has been applied by write() already
+		m_device->writeRenderedBuffer( m_blocks[block], frames, 1.0f );
+
+		lock.relock();
+		++m_tail;
+		m_spaceAvailable.wakeAll();
+	}
+}
@@ -29,7 +29,10 @@
 #include "Engine.h"
 #include "Mixer.h"
 #include "MixHelpers.h"
+#include "MixerWorkerThread.h"
 #include "BufferManager.h"
+#include "panning_constants.h"
+#include "volume.h"
 
 
 AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
@@ -39,8 +42,12 @@ AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
 	m_portBuffer( BufferManager::acquire() ),
 	m_extOutputEnabled( false ),
 	m_nextFxChannel( 0 ),
+	m_fxChannel( NULL ),
+	m_hasOutput( false ),
 	m_name( "unnamed port" ),
 	m_effects( _has_effect_chain ? new EffectChain( NULL ) : NULL ),
+	m_numPlayHandles( 0 ),
+	m_pendingPlayHandles( 0 ),
 	m_volumeModel( volumeModel ),
 	m_panningModel( panningModel ),
 	m_mutedModel( mutedModel )
@@ -103,127 +110,121 @@ bool AudioPort::processEffects()
 
 void AudioPort::doProcessing()
 {
+	m_hasOutput = false;
+
 	if( m_mutedModel && m_mutedModel->value() )
 	{
+		if( m_fxChannel )
+		{
+			m_fxChannel->incrementDeps();
+		}
 		return;
 	}
 
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
-	// clear the buffer
-	BufferManager::clear( m_portBuffer, fpp );
-
-	//qDebug( "Playhandles: %d", m_playHandles.size() );
-	for( PlayHandle * ph : m_playHandles ) // now we mix all playhandle buffers into the audioport buffer
+	m_playHandleBuffers.clear();
+	// most ports have no play handles in most periods
+	const bool hasPlayHandles = m_numPlayHandles > 0;
+	if( hasPlayHandles )
 	{
-		if( ph->buffer() )
+		m_playHandleLock.lock();
+		for( PlayHandle * ph : m_playHandles )
 		{
-			if( ph->usesBuffer() )
+			// skip handles which are going to be removed - in pipelined
+			// mode they are still in our list at this point
+			if( ph->buffer() && ph->usesBuffer() && !Engine::mixer()->playHandleExpires( ph ) )
 			{
-				m_bufferUsage = true;
-				MixHelpers::add( m_portBuffer, ph->buffer(), fpp );
+				m_playHandleBuffers.push_back( ph->buffer() );
 			}
-			ph->releaseBuffer(); 	// gets rid of playhandle's buffer and sets
-									// pointer to null, so if it doesn't get re-acquired we know to skip it next time
 		}
 	}
 
-	if( m_bufferUsage )
+	if( m_playHandleBuffers.empty() )
 	{
-		// handle volume and panning
-		// has both vol and pan models
-		if( m_volumeModel && m_panningModel )
+		BufferManager::clear( m_portBuffer, fpp );
+	}
+	else
+	{
+		m_bufferUsage = true;
+
+		// volume and panning are either taken per frame from the models'
+		// value buffers or broadcasted from their current value
+		float volume = DefaultVolume;
+		float panning = DefaultPanning;
+		const float * volumeBuf = &volume;
+		const float * panningBuf = &panning;
+		int volumeStride = 0;
+		int panningStride = 0;
+
+		if( m_volumeModel )
 		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-			ValueBuffer * panBuf = m_panningModel->valueBuffer();
-
-			// both vol and pan have s.ex.data:
-			if( volBuf && panBuf )
+			if( ValueBuffer * volBuf = m_volumeModel->valueBuffer() )
 			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
+				volumeBuf = volBuf->values();
+				volumeStride = 1;
 			}
-
-			// only vol has s.ex.data:
-			else if( volBuf )
+			else
 			{
-				float p = m_panningModel->value() * 0.01f;
-				float l = ( p <= 0 ? 1.0f : 1.0f - p );
-				float r = ( p >= 0 ? 1.0f : 1.0f + p );
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v * l;
-					m_portBuffer[f][1] *= v * r;
-				}
+				volume = m_volumeModel->value();
 			}
-
-			// only pan has s.ex.data:
-			else if( panBuf )
+		}
+		if( m_panningModel )
+		{
+			if( ValueBuffer * panBuf = m_panningModel->valueBuffer() )
 			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
+				panningBuf = panBuf->values();
+				panningStride = 1;
 			}
-
-			// neither has s.ex.data:
 			else
 			{
-				float p = m_panningModel->value() * 0.01f;
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
+				panning = m_panningModel->value();
 			}
 		}
 
-		// has vol model only
-		else if( m_volumeModel )
-		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
+		// mix all playhandle buffers into the audioport buffer and apply
+		// volume and panning in the same pass
+		MixHelpers::sumWithVolumeAndPanning( m_portBuffer,
+					m_playHandleBuffers.data(), m_playHandleBuffers.size(),
+					volumeBuf, volumeStride, panningBuf, panningStride, fpp );
+	}
 
-			if( volBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
-			else
+	if( hasPlayHandles )
+	{
+		for( PlayHandle * ph : m_playHandles )
+		{
+			if( ph->buffer() )
 			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
+				ph->releaseBuffer(); 	// gets rid of playhandle's buffer and sets
+										// pointer to null, so if it doesn't get re-acquired we know to skip it next time
 			}
 		}
+		m_playHandleLock.unlock();
 	}
-	// as of now there's no situation where we only have panning model but no volume model
-	// if we have neither, we don't have to do anything here - just pass the audio as is
 
 	// handle effects
 	const bool me = processEffects();
 	if( me || m_bufferUsage )
 	{
-		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
-																			// TODO: improve the flow here - convert to pull model
+		// our FX channel pulls the output from our buffer
+		m_hasOutput = true;
 		m_bufferUsage = false;
 	}
+
+	// let FX channel know that our output is ready
+	if( m_fxChannel )
+	{
+		m_fxChannel->incrementDeps();
+	}
+}
+
+
+void AudioPort::playHandleDone()
+{
+	if( m_pendingPlayHandles > 0 && --m_pendingPlayHandles == 0 )
+	{
+		MixerWorkerThread::addJob( this );
+	}
 }
 
 
@@ -231,6 +232,7 @@ void AudioPort::addPlayHandle( PlayHandle * handle )
 {
 	m_playHandleLock.lock();
 		m_playHandles.append( handle );
+		m_numPlayHandles = m_playHandles.size();
 	m_playHandleLock.unlock();
 }
 
@@ -243,5 +245,6 @@ void AudioPort::removePlayHandle( PlayHandle * handle )
 		{
 			m_playHandles.erase( it );
 		}
+		m_numPlayHandles = m_playHandles.size();
 	m_playHandleLock.unlock();
 }
@@ -66,6 +66,7 @@
 #include "ImportFilter.h"
 #include "MainWindow.h"
 #include "OutputSettings.h"
+#include "ParallelRenderer.h"
 #include "ProjectRenderer.h"
 #include "RenderManager.h"
 #include "Song.h"
@@ -154,6 +155,8 @@ void printHelp()
 		"            [ -m <mode>]\n"
 		"            [ -o <path> ]\n"
 		"            [ -p <out> ]\n"
+		"            [ --parallel <sections> [ --preroll <tacts> ] ]\n"
+		"            [ --pipelined ]\n"
 		"            [ -r <project file> ] [ options ]\n"
 		"            [ -s <samplerate> ]\n"
 		"            [ -u <in> <out> ]\n"
@@ -188,9 +191,29 @@ void printHelp()
 		"-o, --output <path>           Render into <path>\n"
 		"       For --render, provide a file path\n"
 		"       For --rendertracks, provide a directory path\n"
+		"    --parallel <sections>     With --render, split the song into\n"
+		"       <sections> parts which are rendered by separate processes\n"
+		"       and crossfaded afterwards\n"
+		"    --preroll <tacts>         With --parallel, start playing each part\n"
+		"       <tacts> earlier so that sound from before it is in place\n"
+		"       (default: 2)\n"
+		"    --threads <threads>       Render with <threads> threads in total\n"
+		"       (default: one per core)\n"
 		"-p, --profile <out>           Dump profiling information to file <out>\n"
+		"    --trace <out>             Write per-stage and per-job timings to <out>\n"
+		"       in Chrome trace event format\n"
+		"    --xrun-log <out>          Append timings of the last periods to <out>\n"
+		"       whenever a period misses its deadline. With --render, periods\n"
+		"       are checked against their deadline when playing live and the\n"
+		"       number of missed deadlines is printed when done\n"
+		"    --xrun-factor <factor>    Only log periods which take <factor> times\n"
+		"       longer than their deadline (default: 1.5)\n"
+		"    --pipelined               Overlap rendering of notes and effects of\n"
+		"       different tracks while rendering\n"
 		"-r, --render <project file>   Render given project file\n"
 		"    --rendertracks <project>  Render each track to a different file\n"
+		"    --fxstems                 With --rendertracks, also render each FX\n"
+		"       channel to a different file\n"
 		"-s, --samplerate <samplerate> Specify output samplerate in Hz\n"
 		"       Range: 44100 (default) to 192000\n"
 		"-u, --upgrade <in> [out]      Upgrade file <in> and save as <out>\n"
@@ -262,10 +285,20 @@ int main( int argc, char * * argv )
 	bool coreOnly = false;
 	bool fullscreen = true;
 	bool exitAfterImport = false;
+	float xrunFactor = 1.5f;
 	bool allowRoot = false;
 	bool renderLoop = false;
+	bool renderPipelined = false;
+	bool renderFxStems = false;
 	bool renderTracks = false;
-	QString fileToLoad, fileToImport, renderOut, profilerOutputFile, configFile;
+	bool renderSection = false;
+	ProjectRenderer::Section section = { 0, 0, 0, 0 };
+	int renderSections = 1;
+	int prerollTacts = 2;
+	int renderThreads = 0;
+	// options which sections of a parallel render need as well
+	QStringList sectionArgs;
+	QString fileToLoad, fileToImport, renderOut, profilerOutputFile, traceOutputFile, xrunLogFile, configFile;
 
 	// first of two command-line parsing stages
 	for( int i = 1; i < argc; ++i )
@@ -361,6 +394,7 @@ int main( int argc, char * * argv )
 		else if( arg == "--allowroot" )
 		{
 			// Ignore, processed earlier
+			sectionArgs << arg;
 #ifdef LMMS_BUILD_WIN32
 			if( allowRoot )
 			{
@@ -403,6 +437,87 @@ int main( int argc, char * * argv )
 		{
 			renderLoop = true;
 		}
+		else if( arg == "--pipelined" )
+		{
+			renderPipelined = true;
+			sectionArgs << arg;
+		}
+		else if( arg == "--parallel" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No number of sections specified" );
+			}
+
+			renderSections = QString( argv[i] ).toInt();
+			if( renderSections < 1 )
+			{
+				return usageError( QString( "Invalid number of sections %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--threads" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No number of threads specified" );
+			}
+
+			renderThreads = QString( argv[i] ).toInt();
+			if( renderThreads < 1 )
+			{
+				return usageError( QString( "Invalid number of threads %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--preroll" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No preroll specified" );
+			}
+
+			bool ok = false;
+			prerollTacts = QString( argv[i] ).toInt( &ok );
+			if( !ok || prerollTacts < 0 )
+			{
+				return usageError( QString( "Invalid preroll %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--section" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No section specified" );
+			}
+
+			// begin:end:preroll:overlap, as passed by --parallel
+			const QStringList parts = QString( argv[i] ).split( ':' );
+			bool ok = parts.size() == 4;
+			for( int p = 0; ok && p < parts.size(); ++p )
+			{
+				parts[p].toInt( &ok );
+			}
+			if( !ok )
+			{
+				return usageError( QString( "Invalid section %1" ).arg( argv[i] ) );
+			}
+			section.begin = parts[0].toInt();
+			section.end = parts[1].toInt();
+			section.preroll = parts[2].toInt();
+			section.overlap = parts[3].toInt();
+			renderSection = true;
+		}
+		else if( arg == "--fxstems" )
+		{
+			renderFxStems = true;
+		}
 		else if( arg == "--output" || arg == "-o" )
 		{
 			++i;
@@ -466,6 +581,7 @@ int main( int argc, char * * argv )
 			if( sr >= 44100 && sr <= 192000 )
 			{
 				os.setSampleRate(sr);
+				sectionArgs << arg << argv[i];
 			}
 			else
 			{
@@ -559,6 +675,7 @@ int main( int argc, char * * argv )
 			{
 				return usageError( QString( "Invalid interpolation method %1" ).arg( argv[i] ) );
 			}
+			sectionArgs << arg << argv[i];
 		}
 		else if( arg == "--oversampling" || arg == "-x" )
 		{
@@ -589,6 +706,7 @@ int main( int argc, char * * argv )
 				default:
 				return usageError( QString( "Invalid oversampling %1" ).arg( argv[i] ) );
 			}
+			sectionArgs << arg << argv[i];
 		}
 		else if( arg == "--import" )
 		{
@@ -620,6 +738,43 @@ int main( int argc, char * * argv )
 
 			profilerOutputFile = QString::fromLocal8Bit( argv[i] );
 		}
+		else if( arg == "--trace" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No trace file specified" );
+			}
+
+			traceOutputFile = QString::fromLocal8Bit( argv[i] );
+		}
+		else if( arg == "--xrun-log" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No xrun log file specified" );
+			}
+
+			xrunLogFile = QString::fromLocal8Bit( argv[i] );
+		}
+		else if( arg == "--xrun-factor" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No xrun factor specified" );
+			}
+
+			xrunFactor = QString( argv[i] ).toFloat();
+			if( xrunFactor < 1.0f )
+			{
+				return usageError( QString( "Invalid xrun factor %1" ).arg( argv[i] ) );
+			}
+		}
 		else if( arg == "--config" || arg == "-c" )
 		{
 			++i;
@@ -630,6 +785,7 @@ int main( int argc, char * * argv )
 			}
 
 			configFile = QString::fromLocal8Bit( argv[i] );
+			sectionArgs << arg << configFile;
 		}
 		else
 		{
@@ -641,6 +797,11 @@ int main( int argc, char * * argv )
 		}
 	}
 
+	if( renderSections > 1 && renderTracks )
+	{
+		return usageError( "--parallel can't be used with --rendertracks" );
+	}
+
 	// Test file argument before continuing
 	if( !fileToLoad.isEmpty() )
 	{
@@ -716,7 +877,7 @@ int main( int argc, char * * argv )
 	// without starting the GUI
 	if( !renderOut.isEmpty() )
 	{
-		Engine::init( true );
+		Engine::init( true, renderThreads );
 		destroyEngine = true;
 
 		printf( "Loading project...\n" );
@@ -738,36 +899,80 @@ int main( int argc, char * * argv )
 				ProjectRenderer::getFileExtensionFromFormat(eff);
 		}
 
-		// create renderer
-		RenderManager * r = new RenderManager( qs, os, eff, renderOut );
-		QCoreApplication::instance()->connect( r,
-				SIGNAL( finished() ), SLOT( quit() ) );
-
-		// timer for progress-updates
-		QTimer * t = new QTimer( r );
-		r->connect( t, SIGNAL( timeout() ),
-				SLOT( updateConsoleProgress() ) );
-		t->start( 200 );
-
-		if( profilerOutputFile.isEmpty() == false )
-		{
-			Engine::mixer()->profiler().setOutputFile( profilerOutputFile );
-		}
-
-		// start now!
-		if ( renderTracks )
+		if( renderSections > 1 )
 		{
-			r->renderTracks();
+			ParallelRenderer * p = new ParallelRenderer( fileToLoad,
+					sectionArgs, os, eff, renderOut,
+					renderSections, prerollTacts, app );
+			QObject::connect( p, &ParallelRenderer::finished,
+						&QCoreApplication::exit );
+
+			QTimer * t = new QTimer( p );
+			p->connect( t, SIGNAL( timeout() ),
+					SLOT( updateConsoleProgress() ) );
+			t->start( 200 );
+
+			p->start();
 		}
 		else
 		{
-			r->renderProject();
+			// create renderer
+			RenderManager * r = new RenderManager( qs, os, eff, renderOut );
+			QCoreApplication::instance()->connect( r,
+					SIGNAL( finished() ), SLOT( quit() ) );
+
+			// timer for progress-updates
+			QTimer * t = new QTimer( r );
+			r->connect( t, SIGNAL( timeout() ),
+					SLOT( updateConsoleProgress() ) );
+			t->start( 200 );
+
+			if( profilerOutputFile.isEmpty() == false )
+			{
+				Engine::mixer()->profiler().setOutputFile( profilerOutputFile );
+			}
+
+			if( traceOutputFile.isEmpty() == false )
+			{
+				Engine::mixer()->profiler().setTraceFile( traceOutputFile );
+			}
+
+			if( xrunLogFile.isEmpty() == false )
+			{
+				Engine::mixer()->profiler().setOfflineXruns( true );
+				Engine::mixer()->profiler().setXrunLog( xrunLogFile, xrunFactor );
+			}
+
+			if( renderPipelined )
+			{
+				Engine::mixer()->setPipelinedRendering();
+			}
+
+			if( renderSection )
+			{
+				r->setSection( section );
+			}
+
+			// start now!
+			if ( renderTracks )
+			{
+				r->renderTracks( renderFxStems );
+			}
+			else
+			{
+				r->renderProject();
+			}
 		}
 	}
 	else // otherwise, start the GUI
 	{
 		new GuiApplication();
 
+		if( xrunLogFile.isEmpty() == false )
+		{
+			Engine::mixer()->profiler().setXrunLog( xrunLogFile, xrunFactor );
+		}
+
 		// re-intialize RNG - shared libraries might have srand() or
 		// srandom() calls in their init procedure
 		srand( getpid() + time( 0 ) );
@@ -938,6 +1143,11 @@ int main( int argc, char * * argv )
 
 	if( destroyEngine )
 	{
+		if( xrunLogFile.isEmpty() == false )
+		{
+			printf( "\n%d periods missed their deadline\n",
+					Engine::mixer()->profiler().xruns() );
+		}
 		Engine::destroy();
 	}
 
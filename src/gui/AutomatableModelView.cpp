@@ -32,8 +32,10 @@
 #include "ControllerConnectionDialog.h"
 #include "ControllerConnection.h"
 #include "embed.h"
+#include "Engine.h"
 #include "GuiApplication.h"
 #include "MainWindow.h"
+#include "Mixer.h"
 #include "StringPairDrag.h"
 
 #include "AutomationEditor.h"
@@ -184,6 +186,8 @@ void AutomatableModelViewSlots::execConnectionDialog()
 		// Actually chose something
 		if( d.chosenController() )
 		{
+			// the mixer reads the connection while processing
+			Engine::mixer()->requestChangeInModel();
 			// Update
 			if( m->controllerConnection() )
 			{
@@ -196,6 +200,7 @@ void AutomatableModelViewSlots::execConnectionDialog()
 				m->setControllerConnection( cc );
 				//cc->setTargetName( m->displayName() );
 			}
+			Engine::mixer()->doneChangeInModel();
 		}
 		// no controller, so delete existing connection
 		else
@@ -214,8 +219,10 @@ void AutomatableModelViewSlots::removeConnection()
 
 	if( m->controllerConnection() )
 	{
+		Engine::mixer()->requestChangeInModel();
 		delete m->controllerConnection();
 		m->setControllerConnection( NULL );
+		Engine::mixer()->doneChangeInModel();
 	}
 }
 
@@ -1349,7 +1349,14 @@ void AutomationEditor::paintEvent(QPaintEvent * pe )
 		//Don't bother doing/rendering anything if there is no automation points
 		if( time_map.size() > 0 )
 		{
-			timeMap::iterator it = time_map.begin();
+			// start with the last section which begins left of the
+			// visible area instead of walking there from the start
+			timeMap::iterator it = time_map.lowerBound( m_currentPosition );
+			while( it != time_map.begin() &&
+				( it == time_map.end() || xCoordOfTick( it.key() ) >= 0 ) )
+			{
+				--it;
+			}
 			while( it+1 != time_map.end() )
 			{
 				// skip this section if it occurs completely before the
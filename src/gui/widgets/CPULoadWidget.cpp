@@ -35,6 +35,8 @@
 CPULoadWidget::CPULoadWidget( QWidget * _parent ) :
 	QWidget( _parent ),
 	m_currentLoad( 0 ),
+	m_xruns( 0 ),
+	m_xrunIndicator( 0 ),
 	m_temp(),
 	m_background( embed::getIconPixmap( "cpuload_bg" ) ),
 	m_leds( embed::getIconPixmap( "cpuload_leds" ) ),
@@ -81,6 +83,13 @@ void CPULoadWidget::paintEvent( QPaintEvent *  )
 			p.drawPixmap( 23, 3, m_leds, 0, 0, w,
 							m_leds.height() );
 		}
+
+		// light up the right end for a while after a missed deadline
+		if( m_xrunIndicator > 0 )
+		{
+			p.fillRect( width() - 4, 3, 2, m_leds.height(),
+							QColor( 255, 0, 0 ) );
+		}
 	}
 	QPainter p( this );
 	p.drawPixmap( 0, 0, m_temp );
@@ -97,6 +106,24 @@ void CPULoadWidget::updateCpuLoad()
 	{
 		m_currentLoad = new_load;
 		m_changed = true;
+	}
+
+	const int xruns = Engine::mixer()->profiler().xruns();
+	if( xruns != m_xruns )
+	{
+		m_xruns = xruns;
+		m_xrunIndicator = 10;
+		m_changed = true;
+	}
+	else if( m_xrunIndicator > 0 && --m_xrunIndicator == 0 )
+	{
+		m_changed = true;
+	}
+
+	updateToolTip();
+
+	if( m_changed )
+	{
 		update();
 	}
 }
@@ -104,5 +131,37 @@ void CPULoadWidget::updateCpuLoad()
 
 
 
+void CPULoadWidget::updateToolTip()
+{
+	const Mixer * mixer = Engine::mixer();
+	QString text = tr( "CPU load\n%1 periods missed their deadline" ).
+								arg( m_xruns );
 
+	// the fifo is only in use while an audio device is playing
+	if( mixer->hasFifoWriter() )
+	{
+		const PeriodFifo::Statistics fifo = mixer->fifoStatistics();
+		text += "\n" + tr( "Audio buffer: %1 of %2 periods filled, "
+					"ran empty %3 times, ran full %4 times" ).
+				arg( fifo.fillLevel ).arg( fifo.depth ).
+				arg( fifo.underruns ).arg( fifo.writerWaits );
+
+		QVector<int> counts;
+		for( int i = 0; i < LatencyHistogram::Buckets; ++i )
+		{
+			counts.append( mixer->fifoLatency().count( i ) );
+		}
+		if( LatencyHistogram::percentile( counts, 100 ) > 0 )
+		{
+			text += "\n" + tr( "Time in buffer: p50 < %1 us, "
+							"p99 < %2 us" ).
+				arg( LatencyHistogram::percentile( counts, 50 ) ).
+				arg( LatencyHistogram::percentile( counts, 99 ) );
+		}
+	}
 
+	if( text != toolTip() )
+	{
+		setToolTip( text );
+	}
+}
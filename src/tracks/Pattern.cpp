@@ -42,6 +42,7 @@
 #include "StringPairDrag.h"
 #include "MainWindow.h"
 
+#include <algorithm>
 #include <limits>
 
 
@@ -56,7 +57,8 @@ Pattern::Pattern( InstrumentTrack * _instrument_track ) :
 	TrackContentObject( _instrument_track ),
 	m_instrumentTrack( _instrument_track ),
 	m_patternType( BeatPattern ),
-	m_steps( MidiTime::stepsPerTact() )
+	m_steps( MidiTime::stepsPerTact() ),
+	m_playCursor( 0 )
 {
 	setName( _instrument_track->name() );
 	if( _instrument_track->trackContainer()
@@ -75,7 +77,8 @@ Pattern::Pattern( const Pattern& other ) :
 	TrackContentObject( other.m_instrumentTrack ),
 	m_instrumentTrack( other.m_instrumentTrack ),
 	m_patternType( other.m_patternType ),
-	m_steps( other.m_steps )
+	m_steps( other.m_steps ),
+	m_playCursor( 0 )
 {
 	for( NoteVector::ConstIterator it = other.m_notes.begin(); it != other.m_notes.end(); ++it )
 	{
@@ -252,6 +255,45 @@ void Pattern::removeNote( Note * _note_to_del )
 }
 
 
+
+
+NoteVector::ConstIterator Pattern::firstNoteFrom( const MidiTime & pos ) const
+{
+	// number of notes we step over before doing a binary search instead
+	const int MaxLinearSteps = 8;
+
+	// the cursor is only a hint - notes might have been edited since
+	// the last call, so verify it before using it
+	const int size = m_notes.size();
+	int cursor = qMin( m_playCursor, size );
+	if( cursor == 0 || m_notes[cursor - 1]->pos() < pos )
+	{
+		for( int steps = 0; cursor < size && m_notes[cursor]->pos() < pos; ++cursor )
+		{
+			if( ++steps > MaxLinearSteps )
+			{
+				cursor = -1;
+				break;
+			}
+		}
+	}
+	else
+	{
+		cursor = -1;
+	}
+
+	if( cursor < 0 )
+	{
+		// notes are kept sorted by position
+		cursor = std::lower_bound( m_notes.begin(), m_notes.end(), pos,
+			[]( const Note * note, const MidiTime & p ) { return note->pos() < p; } ) - m_notes.begin();
+	}
+
+	m_playCursor = cursor;
+	return m_notes.begin() + cursor;
+}
+
+
 // returns a pointer to the note at specified step, or NULL if note doesn't exist
 
 Note * Pattern::noteAtStep( int _step )
@@ -0,0 +1,155 @@
+/*
+ * StressProjects.cpp - projects rendered by the benchmarks
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "StressProjects.h"
+
+#include "AudioPort.h"
+#include "AutomationPattern.h"
+#include "AutomationTrack.h"
+#include "Effect.h"
+#include "EffectChain.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "Note.h"
+#include "Pattern.h"
+#include "Song.h"
+
+namespace
+{
+
+const int Bars = 16;
+
+InstrumentTrack* createInstrumentTrack(Song* song)
+{
+	auto track = dynamic_cast<InstrumentTrack*>(Track::create(Track::InstrumentTrack, song));
+	track->loadInstrument("tripleoscillator");
+	return track;
+}
+
+// fills a pattern spanning all bars with chords of the given size, one
+// every step ticks
+Pattern* fillPattern(InstrumentTrack* track, tick_t step, int chordSize, int baseKey)
+{
+	auto pattern = dynamic_cast<Pattern*>(track->createTCO(MidiTime(0)));
+	const tick_t length = Bars * MidiTime::ticksPerTact();
+	for (tick_t pos = 0; pos < length; pos += step)
+	{
+		for (int i = 0; i < chordSize; ++i)
+		{
+			const int key = baseKey + i * 4 + (pos / step) % 12;
+			pattern->addNote(Note(MidiTime(step), MidiTime(pos), key), false);
+		}
+	}
+	pattern->changeLength(MidiTime(length));
+	return pattern;
+}
+
+void automate(Song* song, AutomatableModel* model, tick_t step, float min, float max)
+{
+	auto track = Track::create(Track::AutomationTrack, song);
+	auto pattern = dynamic_cast<AutomationPattern*>(track->createTCO(MidiTime(0)));
+	pattern->setProgressionType(AutomationPattern::LinearProgression);
+	pattern->addObject(model);
+
+	const tick_t length = Bars * MidiTime::ticksPerTact();
+	for (tick_t pos = 0; pos <= length; pos += step)
+	{
+		pattern->putValue(MidiTime(pos), (pos / step) % 2 ? max : min, false);
+	}
+	pattern->changeLength(MidiTime(length));
+}
+
+void addEffect(EffectChain* chain, const QString& name)
+{
+	Effect* effect = Effect::instantiate(name, chain, nullptr);
+	if (effect)
+	{
+		chain->appendEffect(effect);
+	}
+}
+
+// lots of tracks, each playing a simple line
+void buildManyTracks(Song* song, int scale)
+{
+	for (int i = 0; i < 32 * scale; ++i)
+	{
+		fillPattern(createInstrumentTrack(song), MidiTime::ticksPerTact() / 4, 1, 36 + i % 48);
+	}
+}
+
+// few tracks playing 16th note chords
+void buildDenseNotes(Song* song, int scale)
+{
+	for (int i = 0; i < 4 * scale; ++i)
+	{
+		fillPattern(createInstrumentTrack(song), MidiTime::ticksPerTact() / 16, 6, 36 + i * 7);
+	}
+}
+
+// volume and panning of every track change every few ticks
+void buildHeavyAutomation(Song* song, int scale)
+{
+	for (int i = 0; i < 8 * scale; ++i)
+	{
+		auto track = createInstrumentTrack(song);
+		fillPattern(track, MidiTime::ticksPerTact() / 8, 2, 48 + i);
+		automate(song, track->volumeModel(), 2, 20, 100);
+		automate(song, track->panningModel(), 3, -100, 100);
+	}
+}
+
+// every track goes through its own FX channel with effects and all of
+// them through a group channel before reaching the master
+void buildManyFxChannels(Song* song, int scale)
+{
+	FxMixer* fxMixer = Engine::fxMixer();
+	const int group = fxMixer->createChannel();
+	addEffect(&fxMixer->effectChannel(group)->m_fxChain, "amplifier");
+
+	for (int i = 0; i < 24 * scale; ++i)
+	{
+		auto track = createInstrumentTrack(song);
+		fillPattern(track, MidiTime::ticksPerTact() / 4, 2, 36 + i % 48);
+		addEffect(track->audioPort()->effects(), "amplifier");
+
+		const int channel = fxMixer->createChannel();
+		fxMixer->deleteChannelSend(channel, 0);
+		fxMixer->createChannelSend(channel, group);
+		addEffect(&fxMixer->effectChannel(channel)->m_fxChain, "bassbooster");
+		addEffect(&fxMixer->effectChannel(channel)->m_fxChain, "amplifier");
+		track->effectChannelModel()->setValue(channel);
+	}
+}
+
+} // namespace
+
+
+QList<StressProject> stressProjects()
+{
+	return {
+		{"many-tracks", &buildManyTracks},
+		{"dense-notes", &buildDenseNotes},
+		{"heavy-automation", &buildHeavyAutomation},
+		{"many-fx-channels", &buildManyFxChannels},
+	};
+}
@@ -0,0 +1,41 @@
+/*
+ * StressProjects.h - projects rendered by the benchmarks
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef STRESS_PROJECTS_H
+#define STRESS_PROJECTS_H
+
+#include <QList>
+#include <QString>
+
+class Song;
+
+// Builds one of the bundled stress projects into an empty song. They are
+// generated instead of shipped as .mmp files, so their size can be scaled.
+struct StressProject
+{
+	QString name;
+	void (*build)(Song* song, int scale);
+};
+
+QList<StressProject> stressProjects();
+
+#endif // STRESS_PROJECTS_H
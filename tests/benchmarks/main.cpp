@@ -0,0 +1,377 @@
+/*
+ * main.cpp - renders stress projects and reports the engine's throughput
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include "AutomatableModel.h"
+#include "BufferManager.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "Song.h"
+
+#include "StressProjects.h"
+
+// count all allocations, so we can tell how many happen while rendering
+static std::atomic<long> s_allocations(0);
+
+#ifdef __GLIBC__
+// glibc lets us wrap malloc() itself, which also catches allocations of
+// plugins and libraries written in C - operator new ends up here as well
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* p, std::size_t size);
+
+extern "C" void* malloc(std::size_t size) __THROW
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) __THROW
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, std::size_t size) __THROW
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(p, size);
+}
+#endif
+
+static void countNew()
+{
+#ifndef __GLIBC__
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+	countNew();
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	countNew();
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+#ifdef LMMS_WRAP_RPMALLOC
+// MM_OPERATORS and MM_ALLOC allocate from rpmalloc, which doesn't go
+// through malloc() - the linker redirects its callers here
+extern "C" void* __real_rpmalloc(std::size_t size);
+
+extern "C" void* __wrap_rpmalloc(std::size_t size)
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	return __real_rpmalloc(size);
+}
+#endif
+
+namespace
+{
+
+struct Options
+{
+	int scale = 1;
+	int maxPeriods = 0;
+	double tolerance = 0.1;
+	QString filter;
+	QString output;
+	QString baseline;
+	QStringList projectFiles;
+};
+
+int usage()
+{
+	fprintf(stderr,
+		"Usage: benchmarks [options] [project files...]\n"
+		"  --scale <n>          Make the bundled projects n times bigger\n"
+		"  --periods <n>        Render at most n periods per project\n"
+		"  --filter <name>      Only render bundled projects containing <name>\n"
+		"  --output <file>      Write results to <file> instead of stdout\n"
+		"  --baseline <file>    Fail if the realtime factor of any project\n"
+		"                       dropped compared to an earlier result file\n"
+		"  --tolerance <pct>    Allowed drop for --baseline (default: 10)\n");
+	return EXIT_FAILURE;
+}
+
+bool parseOptions(const QStringList& args, Options& options)
+{
+	for (int i = 1; i < args.size(); ++i)
+	{
+		const QString& arg = args[i];
+		if (arg.startsWith("--"))
+		{
+			if (i + 1 == args.size())
+			{
+				return false;
+			}
+			const QString value = args[++i];
+			if (arg == "--scale") { options.scale = qMax(value.toInt(), 1); }
+			else if (arg == "--periods") { options.maxPeriods = qMax(value.toInt(), 0); }
+			else if (arg == "--filter") { options.filter = value; }
+			else if (arg == "--output") { options.output = value; }
+			else if (arg == "--baseline") { options.baseline = value; }
+			else if (arg == "--tolerance") { options.tolerance = value.toDouble() / 100; }
+			else { return false; }
+		}
+		else
+		{
+			options.projectFiles << arg;
+		}
+	}
+	return true;
+}
+
+// renders the current song the same way ProjectRenderer does, just
+// without encoding the result
+QJsonObject render(const QString& name, const Options& options)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Song* song = Engine::getSong();
+	Mixer* mixer = Engine::mixer();
+
+	song->setExportLoop(false);
+	song->startExport();
+	song->updateLength();
+	mixer->nextBuffer();
+
+	const auto endpoints = song->getExportEndpoints();
+	const tick_t endTick = endpoints.second.getTicks();
+	const Song::PlayPos& pos = song->getPlayPos(Song::Mode_PlaySong);
+
+	// don't let the latency list allocate while rendering
+	const fpp_t framesPerPeriod = mixer->framesPerPeriod();
+	int expectedPeriods = (endTick - endpoints.first.getTicks()) *
+					Engine::framesPerTick() / framesPerPeriod + 16;
+	if (options.maxPeriods > 0)
+	{
+		expectedPeriods = qMin(expectedPeriods, options.maxPeriods);
+	}
+	std::vector<int> latencies;
+	latencies.reserve(expectedPeriods);
+
+	const long allocationsBefore = s_allocations.load();
+	const BufferManager::Statistics buffersBefore = BufferManager::statistics();
+	const LocklessAllocator::Statistics playHandlesBefore = mixer->newPlayHandlesStatistics();
+	long resolvedModels = 0;
+	long sampleExactModels = 0;
+	const auto started = Clock::now();
+
+	while (pos.getTicks() < endTick && song->isExporting() &&
+		(options.maxPeriods == 0 || (int) latencies.size() < options.maxPeriods))
+	{
+		const auto periodStarted = Clock::now();
+		mixer->nextBuffer();
+		latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+						Clock::now() - periodStarted).count());
+
+		const AutomatableModel::Statistics models = AutomatableModel::lastPeriodStatistics();
+		resolvedModels += models.resolved;
+		sampleExactModels += models.sampleExact;
+	}
+
+	const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+	const long allocations = s_allocations.load() - allocationsBefore;
+	const BufferManager::Statistics buffers = BufferManager::statistics();
+	const LocklessAllocator::Statistics playHandles = mixer->newPlayHandlesStatistics();
+
+	song->stopExport();
+
+	const int periods = latencies.size();
+	const double audioSeconds = (double) periods * framesPerPeriod / mixer->processingSampleRate();
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&latencies](int p) {
+		return latencies.empty() ? 0 : latencies[qMin<int>(latencies.size() * p / 100, latencies.size() - 1)];
+	};
+
+	QJsonObject result;
+	result["name"] = name;
+	result["periods"] = periods;
+	result["framesPerPeriod"] = framesPerPeriod;
+	result["sampleRate"] = (int) mixer->processingSampleRate();
+	result["seconds"] = elapsed;
+	result["realtimeFactor"] = elapsed > 0 ? audioSeconds / elapsed : 0;
+	result["p50Usecs"] = percentile(50);
+	result["p99Usecs"] = percentile(99);
+	result["maxUsecs"] = latencies.empty() ? 0 : latencies.back();
+	result["allocationsPerPeriod"] = periods ? (double) allocations / periods : 0;
+	result["bufferHighWaterMark"] = buffers.highWaterMark;
+	result["bufferPoolMisses"] = buffers.allocations - buffersBefore.allocations;
+	result["playHandleQueueRetries"] = (double) (playHandles.casRetries - playHandlesBefore.casRetries);
+	result["playHandleQueueExhaustions"] = (double) (playHandles.exhaustions - playHandlesBefore.exhaustions);
+	result["modelsResolvedPerPeriod"] = periods ? (double) resolvedModels / periods : 0;
+	result["sampleExactModelsPerPeriod"] = periods ? (double) sampleExactModels / periods : 0;
+
+	fprintf(stderr, "%-24s %8.2fx realtime  p50 %6d us  p99 %6d us  max %6d us  %.2f allocs/period\n",
+		qPrintable(name), result["realtimeFactor"].toDouble(), percentile(50), percentile(99),
+		result["maxUsecs"].toInt(), result["allocationsPerPeriod"].toDouble());
+
+	return result;
+}
+
+// returns the number of results which are slower than their baseline
+int compareWithBaseline(const QJsonArray& results, const Options& options)
+{
+	QFile file(options.baseline);
+	if (!file.open(QFile::ReadOnly))
+	{
+		fprintf(stderr, "Could not open baseline %s\n", qPrintable(options.baseline));
+		return 1;
+	}
+
+	QJsonObject baseline;
+	for (const QJsonValue& value : QJsonDocument::fromJson(file.readAll()).object()["results"].toArray())
+	{
+		baseline[value.toObject()["name"].toString()] = value;
+	}
+
+	int regressions = 0;
+	for (const QJsonValue& value : results)
+	{
+		const QJsonObject result = value.toObject();
+		const QString name = result["name"].toString();
+		if (!baseline.contains(name))
+		{
+			continue;
+		}
+		const double before = baseline[name].toObject()["realtimeFactor"].toDouble();
+		const double now = result["realtimeFactor"].toDouble();
+		if (now < before * (1 - options.tolerance))
+		{
+			fprintf(stderr, "%s regressed: %.2fx realtime, was %.2fx\n",
+				qPrintable(name), now, before);
+			++regressions;
+		}
+	}
+	return regressions;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+	new QCoreApplication(argc, argv);
+
+	Options options;
+	if (!parseOptions(QCoreApplication::arguments(), options))
+	{
+		return usage();
+	}
+
+	Engine::init(true);
+
+	// render from this thread instead of the dummy audio device's
+	Engine::mixer()->stopProcessing();
+
+	Song* song = Engine::getSong();
+	QJsonArray results;
+
+	for (const StressProject& project : stressProjects())
+	{
+		if (!options.filter.isEmpty() && !project.name.contains(options.filter))
+		{
+			continue;
+		}
+		song->clearProject();
+		project.build(song, options.scale);
+		results.append(render(project.name, options));
+	}
+
+	for (const QString& projectFile : options.projectFiles)
+	{
+		song->loadProject(projectFile);
+		results.append(render(QFileInfo(projectFile).baseName(), options));
+	}
+
+	QJsonObject report;
+	report["results"] = results;
+	const QByteArray json = QJsonDocument(report).toJson();
+
+	if (options.output.isEmpty())
+	{
+		fwrite(json.constData(), 1, json.size(), stdout);
+	}
+	else
+	{
+		QFile file(options.output);
+		if (!file.open(QFile::WriteOnly | QFile::Truncate))
+		{
+			fprintf(stderr, "Could not write %s\n", qPrintable(options.output));
+			return EXIT_FAILURE;
+		}
+		file.write(json);
+	}
+
+	if (!options.baseline.isEmpty() && compareWithBaseline(results, options) > 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
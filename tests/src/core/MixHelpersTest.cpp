@@ -0,0 +1,238 @@
+/*
+ * MixHelpersTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "MixHelpersSimd.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using MixHelpers::Kernels;
+
+class MixHelpersTest : QTestSuite
+{
+	Q_OBJECT
+
+	// odd sizes so that all vector widths also run through their scalar tail
+	static const int Frames = 67;
+
+	struct Buffers
+	{
+		std::vector<float> dst;
+		std::vector<float> src;
+		std::vector<float> coeffs1;
+		std::vector<float> coeffs2;
+	} ;
+
+	static Buffers makeBuffers( int seed, bool withSpecials )
+	{
+		Buffers b;
+		unsigned int state = 1234567u + seed;
+		auto next = [&state]() {
+			state = state * 1664525u + 1013904223u;
+			return ( state >> 8 ) / float( 1 << 24 ) * 2.0f - 1.0f;
+		};
+		for( int i = 0; i < Frames * DEFAULT_CHANNELS; ++i )
+		{
+			b.dst.push_back( next() * 2.0f );
+			b.src.push_back( next() * 6.0f );
+		}
+		for( int f = 0; f < Frames; ++f )
+		{
+			b.coeffs1.push_back( next() );
+			b.coeffs2.push_back( next() );
+		}
+		if( withSpecials )
+		{
+			b.src[3] = std::numeric_limits<float>::infinity();
+			b.src[8] = -std::numeric_limits<float>::infinity();
+			b.src[21] = std::numeric_limits<float>::quiet_NaN();
+			b.src[Frames * DEFAULT_CHANNELS - 1] = std::numeric_limits<float>::quiet_NaN();
+			b.src[40] = 4.0f;
+			b.src[41] = -4.0f;
+			b.src[42] = -0.0f;
+		}
+		return b;
+	}
+
+	static sampleFrame * frames( std::vector<float> & v )
+	{
+		return reinterpret_cast<sampleFrame *>( v.data() );
+	}
+
+	// neither the kernels nor the scalar reference are allowed to fuse
+	// multiplications and additions, so results have to compare equal
+	// exactly (signed zeros and nan payloads aside)
+	static bool sameSamples( const std::vector<float> & a, const std::vector<float> & b )
+	{
+		for( size_t i = 0; i < a.size(); ++i )
+		{
+			if( std::isnan( a[i] ) && std::isnan( b[i] ) )
+			{
+				continue;
+			}
+			if( a[i] != b[i] )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<typename F>
+	static void compareWithScalar( F run )
+	{
+		const Kernels & ref = MixHelpers::scalarKernels();
+		for( const Kernels * k : MixHelpers::supportedKernels() )
+		{
+			for( int seed = 0; seed < 4; ++seed )
+			{
+				Buffers expected = makeBuffers( seed, seed % 2 );
+				Buffers actual = expected;
+				run( ref, expected );
+				run( *k, actual );
+				QVERIFY2( sameSamples( expected.dst, actual.dst ), k->name );
+				QVERIFY2( sameSamples( expected.src, actual.src ), k->name );
+			}
+		}
+	}
+
+private slots:
+	void ActiveKernelsTest()
+	{
+		const std::vector<const Kernels *> supported = MixHelpers::supportedKernels();
+		QCOMPARE( supported.front(), &MixHelpers::scalarKernels() );
+		QCOMPARE( &MixHelpers::activeKernels(), supported.back() );
+	}
+
+	void IsSilentTest()
+	{
+		for( const Kernels * k : MixHelpers::supportedKernels() )
+		{
+			std::vector<float> buf( Frames * DEFAULT_CHANNELS, 0.00000001f );
+			buf[5] = std::numeric_limits<float>::quiet_NaN();
+			QVERIFY2( k->isSilent( frames( buf ), Frames ), k->name );
+			for( size_t i : { size_t( 0 ), size_t( 17 ), buf.size() - 1 } )
+			{
+				std::vector<float> loud = buf;
+				loud[i] = -0.0000001f;
+				QVERIFY2( !k->isSilent( frames( loud ), Frames ), k->name );
+				// frames behind the given range must not be looked at
+				QVERIFY2( k->isSilent( frames( loud ), int( i / 2 ) ), k->name );
+			}
+		}
+	}
+
+	void SanitizeTest()
+	{
+		const Kernels & ref = MixHelpers::scalarKernels();
+		for( const Kernels * k : MixHelpers::supportedKernels() )
+		{
+			for( int seed = 0; seed < 4; ++seed )
+			{
+				Buffers expected = makeBuffers( seed, seed % 2 );
+				Buffers actual = expected;
+				const bool expectedFound = ref.sanitize( frames( expected.src ), Frames );
+				QCOMPARE( k->sanitize( frames( actual.src ), Frames ), expectedFound );
+				QCOMPARE( expectedFound, bool( seed % 2 ) );
+				QVERIFY2( expected.src == actual.src, k->name );
+			}
+		}
+	}
+
+	void AddTest()
+	{
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.add( frames( b.dst ), frames( b.src ), Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addMultiplied( frames( b.dst ), frames( b.src ), 0.7f, Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addMultipliedStereo( frames( b.dst ), frames( b.src ), 0.3f, -1.2f, Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.multiplyAndAddMultiplied( frames( b.dst ), frames( b.src ), 0.9f, 0.1f, Frames );
+		} );
+	}
+
+	void AddMultipliedByBufferTest()
+	{
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addMultipliedByBuffer( frames( b.dst ), frames( b.src ), 0.7f, b.coeffs1.data(), Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addMultipliedByBuffers( frames( b.dst ), frames( b.src ), b.coeffs1.data(), b.coeffs2.data(), Frames );
+		} );
+	}
+
+	void AddSanitizedTest()
+	{
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addSanitizedMultiplied( frames( b.dst ), frames( b.src ), 0.7f, Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addSanitizedMultipliedByBuffer( frames( b.dst ), frames( b.src ), 0.7f, b.coeffs1.data(), Frames );
+		} );
+		compareWithScalar( []( const Kernels & k, Buffers & b ) {
+			k.addSanitizedMultipliedByBuffers( frames( b.dst ), frames( b.src ), b.coeffs1.data(), b.coeffs2.data(), Frames );
+		} );
+	}
+
+	void SumWithVolumeAndPanningTest()
+	{
+		const Kernels & ref = MixHelpers::scalarKernels();
+		Buffers a = makeBuffers( 0, false );
+		Buffers b = makeBuffers( 1, false );
+		Buffers c = makeBuffers( 2, true );
+		const sampleFrame * srcs[] = { frames( a.src ), frames( b.src ), frames( c.src ) };
+
+		std::vector<float> volume;
+		std::vector<float> panning;
+		for( int f = 0; f < Frames; ++f )
+		{
+			volume.push_back( a.coeffs1[f] * 100.0f + 100.0f );
+			panning.push_back( a.coeffs2[f] * 100.0f );
+		}
+		panning[0] = 0.0f;
+		panning[1] = -100.0f;
+		panning[2] = 100.0f;
+
+		for( const Kernels * k : MixHelpers::supportedKernels() )
+		{
+			for( int strides = 0; strides < 4; ++strides )
+			{
+				std::vector<float> expected( Frames * DEFAULT_CHANNELS );
+				std::vector<float> actual( Frames * DEFAULT_CHANNELS );
+				ref.sumWithVolumeAndPanning( frames( expected ), srcs, 3,
+						volume.data(), strides & 1, panning.data(), strides >> 1, Frames );
+				k->sumWithVolumeAndPanning( frames( actual ), srcs, 3,
+						volume.data(), strides & 1, panning.data(), strides >> 1, Frames );
+				QVERIFY2( sameSamples( expected, actual ), k->name );
+			}
+		}
+	}
+} MixHelpersTests;
+
+#include "MixHelpersTest.moc"
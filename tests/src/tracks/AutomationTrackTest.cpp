@@ -26,6 +26,7 @@
 
 #include "QCoreApplication"
 
+#include "AutomationCursor.h"
 #include "AutomationPattern.h"
 #include "AutomationTrack.h"
 #include "BBTrack.h"
@@ -74,6 +75,34 @@ private slots:
 		QCOMPARE(p.valueAt(150), 1.0f);
 	}
 
+	void testPatternRendering()
+	{
+		AutomationPattern p(nullptr);
+		p.putValue(10, 0.0, false);
+		p.putValue(20, 1.0, false);
+		p.putValue(40, 0.5, false);
+
+		for (auto progression : {AutomationPattern::DiscreteProgression,
+				AutomationPattern::LinearProgression, AutomationPattern::CubicHermiteProgression})
+		{
+			p.setProgressionType(progression);
+
+			// one frame per tick gives the same values as valueAt()
+			float values[60];
+			p.valuesAt(0, 1, 50, values, 60);
+			for (int i = 0; i < 60; ++i)
+			{
+				QVERIFY(qAbs(values[i] - p.valueAt(qMin(i, 50))) < 1e-5f);
+			}
+		}
+
+		p.setProgressionType(AutomationPattern::LinearProgression);
+		float values[4];
+		p.valuesAt(14.5f, 0.25f, 100, values, 4);
+		QCOMPARE(values[0], 0.45f);
+		QCOMPARE(values[3], 0.525f);
+	}
+
 	void testPatterns()
 	{
 		FloatModel model;
@@ -108,6 +137,52 @@ private slots:
 		QCOMPARE(song->automatedValuesAt(150)[&model], 0.5f);
 	}
 
+	void testCursor()
+	{
+		FloatModel model;
+		FloatModel model2;
+
+		auto song = Engine::getSong();
+		AutomationTrack track(song);
+		TrackContainer::TrackList tracks{&track};
+
+		AutomationPattern p1(&track);
+		p1.setProgressionType(AutomationPattern::LinearProgression);
+		p1.putValue(0, 0.0, false);
+		p1.putValue(10, 1.0, false);
+		p1.movePosition(0);
+		p1.addObject(&model);
+
+		AutomationPattern p2(&track);
+		p2.setProgressionType(AutomationPattern::LinearProgression);
+		p2.putValue(0, 0.0, false);
+		p2.putValue(100, 1.0, false);
+		p2.movePosition(100);
+		p2.addObject(&model);
+
+		AutomationCursor cursor;
+		QCOMPARE(cursor.valuesAt(tracks,   5)[&model], 0.5f);
+		QCOMPARE(cursor.valuesAt(tracks,  50)[&model], 1.0f);
+		QCOMPARE(cursor.valuesAt(tracks, 150)[&model], 0.5f);
+
+		// p1 is overridden by now, but must come back when time moves
+		// backwards or p2 stops controlling the model
+		QCOMPARE(cursor.valuesAt(tracks,   5)[&model], 0.5f);
+		QCOMPARE(cursor.valuesAt(tracks, 150)[&model], 0.5f);
+		p2.setMuted(true);
+		QCOMPARE(cursor.valuesAt(tracks, 150)[&model], 1.0f);
+		p2.setMuted(false);
+
+		// p1 must come back once it controls something not overridden
+		p1.addObject(&model2);
+		QCOMPARE(cursor.valuesAt(tracks, 160)[&model], 0.6f);
+		QCOMPARE(cursor.valuesAt(tracks, 160)[&model2], 1.0f);
+
+		p2.movePosition(200);
+		QCOMPARE(cursor.valuesAt(tracks, 170)[&model], 1.0f);
+		QCOMPARE(cursor.valuesAt(tracks, 250)[&model], 0.5f);
+	}
+
 	void testLengthRespected()
 	{
 		FloatModel model;